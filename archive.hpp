@@ -0,0 +1,496 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "historyquery.hpp"
+#include "snapshot.hpp"
+
+// Column-oriented archive of ORDERS rows, for analytics over more history than the live
+// database should hold. Rows are stored in blocks of up to ARCHIVE_BLOCK_ROWS, and each
+// block stores every column as its own chunk, so a scan reads only the columns it uses.
+// Layout: magic, version, the column chunks of every block, then a footer holding the
+// ticker dictionary and the block index (row count, min/max order ID, price, creation
+// time and ticker, and where each chunk is), then the footer offset, a CRC32C of the
+// footer and the magic again.
+constexpr char ARCHIVE_MAGIC[8] = {'O', 'B', 'A', 'R', 'C', 'H', '0', '1'};
+constexpr std::uint32_t ARCHIVE_VERSION = 1;
+constexpr std::size_t ARCHIVE_BLOCK_ROWS = 65536;
+
+enum class ArchiveColumn : std::uint8_t {
+    ORDER_ID,
+    TICKER,      // Index into the ticker dictionary
+    PRICE,
+    QUANTITY,
+    REMAINING,
+    SIDE,
+    CREATED_AT
+};
+constexpr std::size_t ARCHIVE_COLUMNS = 7;
+
+// How one column chunk is encoded
+enum class ArchiveEncoding : std::uint8_t {
+    VARINT,         // LEB128 per value
+    DELTA_VARINT,   // Zigzag LEB128 of the difference from the previous value
+    DECIMAL_DELTA,  // Scale byte s, then DELTA_VARINT of value * 10^s; used when that is exact
+    RAW_DOUBLE      // 8 bytes per value, for values with no exact decimal scale
+};
+
+struct ArchiveChunk {
+    std::uint64_t offset = 0;
+    std::uint32_t size = 0;
+    ArchiveEncoding encoding = ArchiveEncoding::VARINT;
+};
+
+// Block index entry: the ranges a block covers, so scans can skip it without decoding it
+struct ArchiveBlock {
+    std::uint32_t rows = 0;
+    std::int32_t minOrderId = 0;
+    std::int32_t maxOrderId = 0;
+    double minPrice = 0;
+    double maxPrice = 0;
+    std::int64_t minCreatedAt = 0;
+    std::int64_t maxCreatedAt = 0;
+    std::string minTicker;
+    std::string maxTicker;
+    ArchiveChunk chunks[ARCHIVE_COLUMNS];
+};
+
+inline void appendVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline bool readVarint(const unsigned char*& cursor, const unsigned char* end, std::uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        std::uint8_t byte = *cursor++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+inline std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+inline double archivePowerOfTen(int scale) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    return powers[scale];
+}
+
+inline std::string encodeIntegers(const std::vector<std::int64_t>& values, ArchiveEncoding encoding) {
+    std::string out;
+    std::int64_t previous = 0;
+    for (std::int64_t value : values) {
+        if (encoding == ArchiveEncoding::VARINT) {
+            appendVarint(out, static_cast<std::uint64_t>(value));
+        } else {
+            appendVarint(out, zigzag(value - previous));
+            previous = value;
+        }
+    }
+    return out;
+}
+
+// Prices and quantities are decimals in practice, so they are stored as scaled integers
+// when some scale up to 10^9 reproduces every value in the chunk exactly
+inline std::string encodeDoubles(const std::vector<double>& values, ArchiveEncoding& encoding) {
+    for (int scale = 0; scale <= 9; ++scale) {
+        double power = archivePowerOfTen(scale);
+        bool exact = std::all_of(values.begin(), values.end(), [power](double value) {
+            double scaled = value * power;
+            return std::fabs(scaled) < 9.0e15 && static_cast<double>(std::llround(scaled)) / power == value;
+        });
+        if (!exact) continue;
+
+        std::vector<std::int64_t> scaled;
+        scaled.reserve(values.size());
+        for (double value : values) scaled.push_back(std::llround(value * power));
+        encoding = ArchiveEncoding::DECIMAL_DELTA;
+        return std::string(1, static_cast<char>(scale)) + encodeIntegers(scaled, ArchiveEncoding::DELTA_VARINT);
+    }
+    encoding = ArchiveEncoding::RAW_DOUBLE;
+    return std::string(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+}
+
+inline bool decodeIntegers(const unsigned char* data, std::size_t size, ArchiveEncoding encoding,
+                           std::size_t rows, std::vector<std::int64_t>& values) {
+    if (encoding != ArchiveEncoding::VARINT && encoding != ArchiveEncoding::DELTA_VARINT) return false;
+    values.resize(rows);
+    const unsigned char* end = data + size;
+    std::int64_t previous = 0;
+    for (std::size_t i = 0; i < rows; ++i) {
+        std::uint64_t raw;
+        if (!readVarint(data, end, raw)) return false;
+        if (encoding == ArchiveEncoding::VARINT) {
+            values[i] = static_cast<std::int64_t>(raw);
+        } else {
+            previous += unzigzag(raw);
+            values[i] = previous;
+        }
+    }
+    return true;
+}
+
+inline bool decodeDoubles(const unsigned char* data, std::size_t size, ArchiveEncoding encoding,
+                          std::size_t rows, std::vector<double>& values) {
+    if (encoding == ArchiveEncoding::RAW_DOUBLE) {
+        if (size != rows * sizeof(double)) return false;
+        values.resize(rows);
+        std::memcpy(values.data(), data, size);
+        return true;
+    }
+    if (encoding != ArchiveEncoding::DECIMAL_DELTA || size == 0 || data[0] > 9) return false;
+    double power = archivePowerOfTen(data[0]);
+    std::vector<std::int64_t> scaled;
+    if (!decodeIntegers(data + 1, size - 1, ArchiveEncoding::DELTA_VARINT, rows, scaled)) return false;
+    values.resize(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        values[i] = static_cast<double>(scaled[i]) / power;
+    }
+    return true;
+}
+
+// Builds an archive from rows in any order. Rows are buffered a block at a time; writing them
+// sorted by ticker keeps each ticker in few blocks, so ticker scans can skip the rest.
+// The file is written under a temporary name, synced and renamed by finish().
+class ArchiveWriter {
+public:
+    bool open(const std::string& path) {
+        path_ = path;
+        out_.open(path + ".tmp", std::ios::binary | std::ios::trunc);
+        if (!out_) {
+            std::cerr << "Failed to create archive " << path << ".tmp" << std::endl;
+            return false;
+        }
+        out_.write(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+        out_.write(reinterpret_cast<const char*>(&ARCHIVE_VERSION), sizeof(ARCHIVE_VERSION));
+        offset_ = sizeof(ARCHIVE_MAGIC) + sizeof(ARCHIVE_VERSION);
+        return true;
+    }
+
+    void add(const HistoryRow& row) {
+        pending_.push_back(row);
+        ++rows_;
+        if (pending_.size() == ARCHIVE_BLOCK_ROWS) {
+            flushBlock();
+        }
+    }
+
+    // Write the last block and the footer, then move the archive into place
+    bool finish() {
+        flushBlock();
+        SnapshotBuffer footer;
+        footer.put(static_cast<std::uint32_t>(dictionary_.size()));
+        for (const std::string& ticker : dictionary_) footer.putString(ticker);
+        footer.put(static_cast<std::uint32_t>(blocks_.size()));
+        for (const ArchiveBlock& block : blocks_) {
+            footer.put(block.rows);
+            footer.put(block.minOrderId);
+            footer.put(block.maxOrderId);
+            footer.put(block.minPrice);
+            footer.put(block.maxPrice);
+            footer.put(block.minCreatedAt);
+            footer.put(block.maxCreatedAt);
+            footer.putString(block.minTicker);
+            footer.putString(block.maxTicker);
+            for (const ArchiveChunk& chunk : block.chunks) {
+                footer.put(chunk.offset);
+                footer.put(chunk.size);
+                footer.put(chunk.encoding);
+            }
+        }
+        std::uint64_t footerOffset = offset_;
+        std::uint32_t checksum = crc32c(footer.bytes.data(), footer.bytes.size());
+        out_.write(footer.bytes.data(), static_cast<std::streamsize>(footer.bytes.size()));
+        out_.write(reinterpret_cast<const char*>(&footerOffset), sizeof(footerOffset));
+        out_.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        out_.write(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+        out_.flush();
+        bool ok = static_cast<bool>(out_);
+        out_.close();
+        // Synced before it is renamed, so rows can be deleted elsewhere once finish() returns
+        int fd = ::open((path_ + ".tmp").c_str(), O_RDONLY);
+        ok = ok && fd >= 0 && fsync(fd) == 0;
+        if (fd >= 0) ::close(fd);
+        if (!ok) {
+            std::cerr << "Failed to write archive " << path_ << ".tmp" << std::endl;
+            return false;
+        }
+        if (std::rename((path_ + ".tmp").c_str(), path_.c_str()) != 0) {
+            std::cerr << "Failed to install archive " << path_ << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::size_t rows() const { return rows_; }
+
+private:
+    void flushBlock() {
+        if (pending_.empty()) return;
+        ArchiveBlock block;
+        block.rows = static_cast<std::uint32_t>(pending_.size());
+        block.minOrderId = block.maxOrderId = pending_.front().orderId;
+        block.minPrice = block.maxPrice = pending_.front().price;
+        block.minCreatedAt = block.maxCreatedAt = pending_.front().createdAt;
+        block.minTicker = block.maxTicker = pending_.front().ticker;
+
+        std::vector<std::int64_t> orderIds, tickers, sides, createdAt;
+        std::vector<double> prices, quantities, remaining;
+        for (const HistoryRow& row : pending_) {
+            block.minOrderId = std::min(block.minOrderId, row.orderId);
+            block.maxOrderId = std::max(block.maxOrderId, row.orderId);
+            block.minPrice = std::min(block.minPrice, row.price);
+            block.maxPrice = std::max(block.maxPrice, row.price);
+            block.minCreatedAt = std::min(block.minCreatedAt, row.createdAt);
+            block.maxCreatedAt = std::max(block.maxCreatedAt, row.createdAt);
+            block.minTicker = std::min(block.minTicker, row.ticker);
+            block.maxTicker = std::max(block.maxTicker, row.ticker);
+
+            auto [it, added] = tickerIds_.try_emplace(row.ticker, static_cast<std::uint32_t>(dictionary_.size()));
+            if (added) dictionary_.push_back(row.ticker);
+
+            orderIds.push_back(row.orderId);
+            tickers.push_back(it->second);
+            prices.push_back(row.price);
+            quantities.push_back(row.quantity);
+            remaining.push_back(row.remaining);
+            sides.push_back(static_cast<std::int64_t>(row.side));
+            createdAt.push_back(row.createdAt);
+        }
+
+        auto writeChunk = [this, &block](ArchiveColumn column, const std::string& bytes, ArchiveEncoding encoding) {
+            ArchiveChunk& chunk = block.chunks[static_cast<std::size_t>(column)];
+            chunk.offset = offset_;
+            chunk.size = static_cast<std::uint32_t>(bytes.size());
+            chunk.encoding = encoding;
+            out_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            offset_ += bytes.size();
+        };
+        ArchiveEncoding encoding;
+        writeChunk(ArchiveColumn::ORDER_ID, encodeIntegers(orderIds, ArchiveEncoding::DELTA_VARINT), ArchiveEncoding::DELTA_VARINT);
+        writeChunk(ArchiveColumn::TICKER, encodeIntegers(tickers, ArchiveEncoding::VARINT), ArchiveEncoding::VARINT);
+        std::string bytes = encodeDoubles(prices, encoding);
+        writeChunk(ArchiveColumn::PRICE, bytes, encoding);
+        bytes = encodeDoubles(quantities, encoding);
+        writeChunk(ArchiveColumn::QUANTITY, bytes, encoding);
+        bytes = encodeDoubles(remaining, encoding);
+        writeChunk(ArchiveColumn::REMAINING, bytes, encoding);
+        writeChunk(ArchiveColumn::SIDE, encodeIntegers(sides, ArchiveEncoding::VARINT), ArchiveEncoding::VARINT);
+        writeChunk(ArchiveColumn::CREATED_AT, encodeIntegers(createdAt, ArchiveEncoding::DELTA_VARINT), ArchiveEncoding::DELTA_VARINT);
+
+        blocks_.push_back(std::move(block));
+        pending_.clear();
+    }
+
+    std::ofstream out_;
+    std::string path_;
+    std::uint64_t offset_ = 0;
+    std::size_t rows_ = 0;
+    std::vector<HistoryRow> pending_;
+    std::vector<std::string> dictionary_;
+    std::unordered_map<std::string, std::uint32_t> tickerIds_;
+    std::vector<ArchiveBlock> blocks_;
+};
+
+// Reads an archive through a read-only memory map. Only the chunks a scan decodes are paged
+// in, and blocks whose index ranges cannot match are skipped without touching their data.
+class ArchiveReader {
+public:
+    ArchiveReader() = default;
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    ~ArchiveReader() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info{};
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            std::cerr << "Failed to open archive " << path << ": " << std::strerror(errno) << std::endl;
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ > 0) {
+            void* mapped = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            data_ = mapped == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(mapped);
+        }
+        ::close(fd);
+        if (!data_ || !readFooter()) {
+            std::cerr << "Archive " << path << " is missing, truncated or corrupt" << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (data_) {
+            munmap(const_cast<unsigned char*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+        dictionary_.clear();
+        blocks_.clear();
+    }
+
+    [[nodiscard]] const std::vector<std::string>& tickers() const { return dictionary_; }
+    [[nodiscard]] const std::vector<ArchiveBlock>& blocks() const { return blocks_; }
+
+    [[nodiscard]] std::size_t rowCount() const {
+        std::size_t rows = 0;
+        for (const ArchiveBlock& block : blocks_) rows += block.rows;
+        return rows;
+    }
+
+    // Decode one integer column (ORDER_ID, TICKER, SIDE, CREATED_AT) of one block
+    bool readIntegers(std::size_t block, ArchiveColumn column, std::vector<std::int64_t>& values) const {
+        const ArchiveChunk& chunk = blocks_[block].chunks[static_cast<std::size_t>(column)];
+        return chunkInBounds(chunk)
+            && decodeIntegers(data_ + chunk.offset, chunk.size, chunk.encoding, blocks_[block].rows, values);
+    }
+
+    // Decode one numeric column (PRICE, QUANTITY, REMAINING) of one block
+    bool readDoubles(std::size_t block, ArchiveColumn column, std::vector<double>& values) const {
+        const ArchiveChunk& chunk = blocks_[block].chunks[static_cast<std::size_t>(column)];
+        return chunkInBounds(chunk)
+            && decodeDoubles(data_ + chunk.offset, chunk.size, chunk.encoding, blocks_[block].rows, values);
+    }
+
+    // Every row matching the query (pageSize is ignored), block by block. Blocks are pruned
+    // on their ticker, order ID and creation time ranges; in the rest the ticker column is
+    // checked first and the other columns are decoded only if some row has the ticker.
+    template <typename Fn>
+    bool scan(const HistoryQuery& query, Fn&& fn) const {
+        std::vector<std::int64_t> orderIds, tickers, sides, createdAt;
+        std::vector<double> prices, quantities, remaining;
+        for (std::size_t b = 0; b < blocks_.size(); ++b) {
+            const ArchiveBlock& block = blocks_[b];
+            if (!query.ticker.empty() && (query.ticker < block.minTicker || query.ticker > block.maxTicker)) continue;
+            if (query.minOrderId && block.maxOrderId < query.minOrderId) continue;
+            if (query.maxOrderId && block.minOrderId > query.maxOrderId) continue;
+            if (query.fromTime && block.maxCreatedAt < query.fromTime) continue;
+            if (query.toTime && (block.minCreatedAt > query.toTime || block.maxCreatedAt == 0)) continue;
+
+            if (!readIntegers(b, ArchiveColumn::TICKER, tickers) || !tickersInDictionary(tickers)) return false;
+            if (!query.ticker.empty() && std::none_of(tickers.begin(), tickers.end(), [&](std::int64_t id) {
+                    return dictionary_[static_cast<std::size_t>(id)] == query.ticker; })) {
+                continue;
+            }
+            if (!readIntegers(b, ArchiveColumn::ORDER_ID, orderIds)
+                || !readDoubles(b, ArchiveColumn::PRICE, prices)
+                || !readDoubles(b, ArchiveColumn::QUANTITY, quantities)
+                || !readDoubles(b, ArchiveColumn::REMAINING, remaining)
+                || !readIntegers(b, ArchiveColumn::SIDE, sides)
+                || !readIntegers(b, ArchiveColumn::CREATED_AT, createdAt)) {
+                return false;
+            }
+
+            for (std::size_t i = 0; i < block.rows; ++i) {
+                const std::string& ticker = dictionary_[static_cast<std::size_t>(tickers[i])];
+                Side side = sides[i] == 0 ? Side::BUY : Side::SELL;
+                if ((!query.ticker.empty() && ticker != query.ticker)
+                    || (query.side && side != *query.side)
+                    || (query.minOrderId && orderIds[i] < query.minOrderId)
+                    || (query.maxOrderId && orderIds[i] > query.maxOrderId)
+                    || (query.fromTime && createdAt[i] < query.fromTime)
+                    || (query.toTime && (createdAt[i] == 0 || createdAt[i] > query.toTime))) {
+                    continue;
+                }
+                fn(HistoryRow{static_cast<int>(orderIds[i]), ticker, prices[i], quantities[i], remaining[i],
+                              side, createdAt[i]});
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool tickersInDictionary(const std::vector<std::int64_t>& ids) const {
+        return std::all_of(ids.begin(), ids.end(), [this](std::int64_t id) {
+            return id >= 0 && static_cast<std::size_t>(id) < dictionary_.size();
+        });
+    }
+
+private:
+    [[nodiscard]] bool chunkInBounds(const ArchiveChunk& chunk) const {
+        return chunk.offset <= size_ && chunk.size <= size_ - chunk.offset;
+    }
+
+    bool readFooter() {
+        constexpr std::size_t trailerSize = sizeof(std::uint64_t) + sizeof(std::uint32_t) + sizeof(ARCHIVE_MAGIC);
+        constexpr std::size_t headerSize = sizeof(ARCHIVE_MAGIC) + sizeof(ARCHIVE_VERSION);
+        if (size_ < headerSize + trailerSize
+            || std::memcmp(data_, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0
+            || std::memcmp(data_ + size_ - sizeof(ARCHIVE_MAGIC), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) {
+            return false;
+        }
+        std::uint32_t version;
+        std::memcpy(&version, data_ + sizeof(ARCHIVE_MAGIC), sizeof(version));
+        std::uint64_t footerOffset;
+        std::uint32_t checksum;
+        std::memcpy(&footerOffset, data_ + size_ - trailerSize, sizeof(footerOffset));
+        std::memcpy(&checksum, data_ + size_ - trailerSize + sizeof(footerOffset), sizeof(checksum));
+        if (version != ARCHIVE_VERSION || footerOffset < headerSize || footerOffset > size_ - trailerSize) {
+            return false;
+        }
+
+        SnapshotBuffer footer;
+        footer.bytes.assign(reinterpret_cast<const char*>(data_) + footerOffset, size_ - trailerSize - footerOffset);
+        if (crc32c(footer.bytes.data(), footer.bytes.size()) != checksum) {
+            return false;
+        }
+
+        std::uint32_t tickerCount, blockCount;
+        if (!footer.get(tickerCount)) return false;
+        dictionary_.resize(tickerCount);
+        for (std::string& ticker : dictionary_) {
+            if (!footer.getString(ticker)) return false;
+        }
+        if (!footer.get(blockCount)) return false;
+        blocks_.resize(blockCount);
+        for (ArchiveBlock& block : blocks_) {
+            if (!footer.get(block.rows) || !footer.get(block.minOrderId) || !footer.get(block.maxOrderId)
+                || !footer.get(block.minPrice) || !footer.get(block.maxPrice)
+                || !footer.get(block.minCreatedAt) || !footer.get(block.maxCreatedAt)
+                || !footer.getString(block.minTicker) || !footer.getString(block.maxTicker)) {
+                return false;
+            }
+            for (ArchiveChunk& chunk : block.chunks) {
+                if (!footer.get(chunk.offset) || !footer.get(chunk.size) || !footer.get(chunk.encoding)) return false;
+            }
+        }
+        return true;
+    }
+
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::vector<std::string> dictionary_;
+    std::vector<ArchiveBlock> blocks_;
+};
+
+#endif // ARCHIVE_H
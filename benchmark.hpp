@@ -0,0 +1,700 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iterator>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "orderbook.hpp"
+#include "persistence.hpp"
+#include "journal.hpp"
+#include "storage.hpp"
+#include "sqlitestore.hpp"
+#include "parallelload.hpp"
+#include "pgstore.hpp"
+#include "reporting.hpp"
+#include "tickercache.hpp"
+#include "httpclient.hpp"
+#include "mockhttp.hpp"
+#include "priceservice.hpp"
+#include "priceband.hpp"
+#include "numparse.hpp"
+
+// Scratch database used by the benchmarks; removed before and after each run
+const std::string BENCHMARK_DB_PATH = "benchmark_orderhistory.db";
+const std::string BENCHMARK_JOURNAL_PATH = "benchmark_orderjournal.bin";
+const std::string BENCHMARK_ARCHIVE_PATH = "benchmark_orderhistory.obarc";
+
+// Delete the scratch database along with its WAL side files
+inline void removeBenchmarkDB() {
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::remove((BENCHMARK_DB_PATH + suffix).c_str());
+    }
+}
+
+// Orders per second written to order history for a range of group-commit window sizes.
+// Orders are placed at non-crossing prices so only ORDER events reach the writer.
+inline void runGroupCommitBenchmark(std::size_t orders, const SqliteProfile& profile) {
+    const std::vector<std::size_t> windowSizes = {1, 10, 100, 1000, 10000};
+
+    std::cout << "Group commit benchmark: " << orders << " orders per run, SQLite profile '" << profile.name << "'\n";
+    std::cout << std::left
+              << std::setw(14) << "WINDOW ROWS"
+              << std::setw(14) << "BATCHES"
+              << std::setw(16) << "AVG BATCH"
+              << std::setw(16) << "ORDERS/SEC" << "\n";
+    std::cout << std::string(60, '-') << "\n";
+
+    for (std::size_t windowSize : windowSizes) {
+        removeBenchmarkDB();
+        SqliteStore store;
+        store.open(BENCHMARK_DB_PATH, profile);
+        OrderBook book(&store);
+
+        std::size_t batches = 0;
+        auto start = std::chrono::steady_clock::now();
+        {
+            GroupCommitPolicy policy{windowSize, std::chrono::microseconds(1000)};
+            PersistenceWriter writer(store, DurabilityMode::AFTER_MATCH, policy,
+                                     [&batches](const CommitBatch&) { ++batches; });
+            book.publisher = &writer;
+            for (std::size_t i = 0; i < orders; ++i) {
+                Side side = (i % 2 == 0) ? Side::BUY : Side::SELL;
+                double price = (side == Side::BUY) ? 90.0 - static_cast<double>(i % 10) : 110.0 + static_cast<double>(i % 10);
+                book.publish(PersistEvent::make(PersistEventType::ORDER,
+                    Order(static_cast<int>(i + 1), price, 1.0, side, "BENCH")));
+            }
+            // Destroying the writer drains and commits everything still queued
+        }
+        book.publisher = nullptr;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::left
+                  << std::setw(14) << windowSize
+                  << std::setw(14) << batches
+                  << std::setw(16) << std::fixed << std::setprecision(1)
+                  << (batches ? static_cast<double>(orders) / batches : 0.0)
+                  << std::setw(16) << std::setprecision(0) << orders / seconds
+                  << std::defaultfloat << "\n";
+    }
+    removeBenchmarkDB();
+}
+
+// Average cost of appending one event to the binary journal, with no downstream stage
+inline void runJournalBenchmark(std::size_t events) {
+    std::remove(BENCHMARK_JOURNAL_PATH.c_str());
+    EventJournal journal;
+    if (!journal.open(BENCHMARK_JOURNAL_PATH)) {
+        return;
+    }
+
+    PersistEvent event = PersistEvent::make(PersistEventType::ORDER, Order(1, 100.0, 1.0, Side::BUY, "BENCH"));
+    journal.append(event);  // Fault in the first page before timing
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < events; ++i) {
+        event.orderId = static_cast<int>(i + 2);
+        journal.append(event);
+    }
+    double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Journal benchmark: " << events << " appends, "
+              << std::fixed << std::setprecision(1) << nanos / events << " ns per append"
+              << std::defaultfloat << "\n";
+    journal.close();
+    std::remove(BENCHMARK_JOURNAL_PATH.c_str());
+}
+
+// Fill ORDERS with a synthetic history: rows spread over 500 tickers, created 10 ms apart,
+// with one in ten fully filled
+inline void fillBenchmarkOrders(SqliteStore& store, std::size_t rows) {
+    sqlite3_exec(store.DB, "BEGIN;", nullptr, nullptr, nullptr);
+    sqlite3_stmt* insert = nullptr;
+    sqlite3_prepare_v2(store.DB,
+        "INSERT INTO ORDERS (ORDER_ID, TICKER, PRICE, QUANTITY, SIDE, REMAINING, CREATED_AT) VALUES (?, ?, ?, ?, ?, ?, ?);",
+        -1, &insert, nullptr);
+    const std::int64_t start = 1704067200000;  // 2024-01-01 UTC
+    for (std::size_t i = 1; i <= rows; ++i) {
+        std::string ticker = "SYM" + std::to_string(i % 500);
+        bool buy = (i / 500) % 2 == 0;
+        double price = buy ? 100.0 - static_cast<double>(i % 50) * 0.01 : 101.0 + static_cast<double>(i % 50) * 0.01;
+        sqlite3_bind_int(insert, 1, static_cast<int>(i));
+        sqlite3_bind_text(insert, 2, ticker.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(insert, 3, price);
+        sqlite3_bind_double(insert, 4, 10.0);
+        sqlite3_bind_int(insert, 5, buy ? 0 : 1);
+        sqlite3_bind_double(insert, 6, i % 10 == 0 ? 0.0 : 10.0);
+        sqlite3_bind_int64(insert, 7, start + static_cast<std::int64_t>(i) * 10);
+        sqlite3_step(insert);
+        sqlite3_reset(insert);
+    }
+    sqlite3_finalize(insert);
+    sqlite3_exec(store.DB, "COMMIT;", nullptr, nullptr, nullptr);
+}
+
+// Startup load time of a synthetic history against loader thread count.
+// One row in ten is fully filled and must be skipped.
+inline void runStartupLoadBenchmark(std::size_t rows) {
+    const SqliteProfile& profile = *findSqliteProfile("fast");
+    removeBenchmarkDB();
+    // The store stays open while the loaders run, as it does at startup
+    SqliteStore store;
+    store.open(BENCHMARK_DB_PATH, profile);
+    fillBenchmarkOrders(store, rows);
+
+    std::cout << "Startup load benchmark: " << rows << " rows of history\n";
+    std::cout << std::left
+              << std::setw(14) << "THREADS"
+              << std::setw(14) << "LOADED"
+              << std::setw(14) << "SECONDS"
+              << std::setw(16) << "ROWS/SEC" << "\n";
+    std::cout << std::string(58, '-') << "\n";
+
+    auto report = [rows](const std::string& label, std::size_t loaded, double seconds) {
+        std::cout << std::left
+                  << std::setw(14) << label
+                  << std::setw(14) << loaded
+                  << std::setw(14) << std::fixed << std::setprecision(3) << seconds
+                  << std::setw(16) << std::setprecision(0) << rows / seconds
+                  << std::defaultfloat << "\n";
+    };
+
+    {
+        OrderBook book;
+        auto start = std::chrono::steady_clock::now();
+        store.loadLiveOrdersSerial(book);
+        report("serial", book.orderIndex.size(),
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    for (std::size_t threads : {1, 2, 4, 8, 16}) {
+        OrderBook book;
+        auto start = std::chrono::steady_clock::now();
+        loadOrdersParallel(BENCHMARK_DB_PATH, book, threads);
+        report(std::to_string(threads), book.orderIndex.size(),
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    removeBenchmarkDB();
+}
+
+// Push a synthetic stream of journaled events (seven orders to three fills) through the
+// persistence stage into a sink; returns events per second
+inline double measureSinkThroughput(EventSink& sink, std::size_t events) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        PersistenceWriter writer(sink, DurabilityMode::AFTER_MATCH);
+        int nextOrderId = 1;
+        for (std::size_t i = 1; i <= events; ++i) {
+            PersistEvent event;
+            if (i % 10 < 7 || nextOrderId < 3) {
+                event = PersistEvent::make(PersistEventType::ORDER,
+                    Order(nextOrderId++, 100.0 + static_cast<double>(i % 20), 5.0, i % 2 ? Side::BUY : Side::SELL, "BENCH"));
+            } else {
+                event = PersistEvent::make(PersistEventType::FILL,
+                    Order(nextOrderId - 1, 100.0, 1.0, Side::BUY, "BENCH"));
+                event.matchedOrderId = nextOrderId - 2;
+            }
+            event.sequence = i;
+            writer.publish(event);
+        }
+        // Destroying the writer drains and commits everything still queued
+    }
+    return static_cast<double>(events) / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Sustained order history write throughput of each storage backend, with the default group commit window
+inline void runStorageBenchmark(std::size_t events, const SqliteProfile& profile, const std::string& pgConnection) {
+    std::cout << "Storage benchmark: " << events << " events per backend\n";
+    std::cout << std::left << std::setw(28) << "BACKEND" << std::setw(16) << "EVENTS/SEC" << "\n";
+    std::cout << std::string(44, '-') << "\n";
+
+    removeBenchmarkDB();
+    {
+        SqliteStore store;
+        store.open(BENCHMARK_DB_PATH, profile);
+        double rate = measureSinkThroughput(store, events);
+        std::cout << std::left << std::setw(28) << ("sqlite (" + std::string(profile.name) + ")")
+                  << std::fixed << std::setprecision(0) << rate << std::defaultfloat << "\n";
+    }
+    removeBenchmarkDB();
+
+#ifdef ORDERBOOK_HAS_POSTGRES
+    // Runs against whatever database the connection string names; its tables are emptied first
+    PostgresStore postgres;
+    if (postgres.open(pgConnection) && postgres.truncate()) {
+        double rate = measureSinkThroughput(postgres, events);
+        std::cout << std::left << std::setw(28) << "postgres"
+                  << std::fixed << std::setprecision(0) << rate << std::defaultfloat << "\n";
+    }
+#else
+    std::cout << std::left << std::setw(28) << "postgres" << "not built (libpqxx not found)\n";
+    (void)pgConnection;
+#endif
+}
+
+// Matcher throughput with each local storage backend behind it, wired as the program wires
+// them: the journal in front of the persistence stage, which feeds the history store.
+// Orders alternate sides around one price so roughly half of them trade.
+inline void runMatchingBenchmark(std::size_t orders, const SqliteProfile& profile) {
+    std::cout << "Matching benchmark: " << orders << " orders per backend\n";
+    std::cout << std::left << std::setw(28) << "BACKEND" << std::setw(16) << "ORDERS/SEC" << "\n";
+    std::cout << std::string(44, '-') << "\n";
+
+    for (const std::string backend : {"null", "journal", "sqlite"}) {
+        removeBenchmarkDB();
+        std::remove(BENCHMARK_JOURNAL_PATH.c_str());
+
+        EventJournal journal;
+        std::unique_ptr<StorageBackend> store;
+        if (backend == "null") {
+            store = std::make_unique<NullStore>();
+        } else if (backend == "journal") {
+            store = std::make_unique<JournalStore>(journal);
+        } else {
+            auto sqlite = std::make_unique<SqliteStore>();
+            sqlite->open(BENCHMARK_DB_PATH, profile);
+            store = std::move(sqlite);
+        }
+        if (backend != "null" && !journal.open(BENCHMARK_JOURNAL_PATH)) {
+            continue;
+        }
+
+        OrderBook book(store.get());
+        std::cout.setstate(std::ios::failbit);  // Silence the matcher's per-trade output while timing
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::unique_ptr<PersistenceWriter> writer;
+            if (backend == "sqlite") {
+                writer = std::make_unique<PersistenceWriter>(*store, DurabilityMode::AFTER_MATCH);
+                journal.downstream = writer.get();
+            }
+            if (backend != "null") {
+                book.publisher = &journal;
+            }
+            for (std::size_t i = 0; i < orders; ++i) {
+                Side side = (i % 2 == 0) ? Side::BUY : Side::SELL;
+                double price = 100.0 + static_cast<double>(i % 7) - 3.0;
+                Order order(static_cast<int>(i + 1), price, 1.0 + static_cast<double>(i % 3), side, "BENCH");
+                book.addOrder(order);
+            }
+            book.publisher = nullptr;
+            // Destroying the writer drains and commits everything still queued
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout.clear();
+
+        std::cout << std::left << std::setw(28) << store->name()
+                  << std::fixed << std::setprecision(0) << orders / seconds << std::defaultfloat << "\n";
+        journal.close();
+    }
+    removeBenchmarkDB();
+    std::remove(BENCHMARK_JOURNAL_PATH.c_str());
+}
+
+// Size and scan speed of the columnar archive against the ORDERS table it was built from:
+// a per-ticker summary over every row, and the same summary for a single ticker
+inline void runArchiveBenchmark(std::size_t rows) {
+    removeBenchmarkDB();
+    SqliteStore store;
+    store.open(BENCHMARK_DB_PATH, *findSqliteProfile("fast"));
+    fillBenchmarkOrders(store, rows);
+    sqlite3_exec(store.DB, "PRAGMA wal_checkpoint(TRUNCATE);", nullptr, nullptr, nullptr);
+
+    auto seconds = [](auto start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto start = std::chrono::steady_clock::now();
+    archiveQuery(store.DB,
+        "SELECT ORDER_ID, TICKER, PRICE, QUANTITY, REMAINING, SIDE, CREATED_AT FROM ORDERS ORDER BY TICKER, ORDER_ID;",
+        BENCHMARK_ARCHIVE_PATH);
+    double archiveSeconds = seconds(start);
+
+    ArchiveReader archive;
+    if (!archive.open(BENCHMARK_ARCHIVE_PATH)) {
+        removeBenchmarkDB();
+        return;
+    }
+    std::cout << "Archive benchmark: " << rows << " orders, archived in " << std::fixed << std::setprecision(3)
+              << archiveSeconds << " s\n"
+              << "  SQLite file  " << std::filesystem::file_size(BENCHMARK_DB_PATH) << " bytes\n"
+              << "  Archive      " << std::filesystem::file_size(BENCHMARK_ARCHIVE_PATH) << " bytes in "
+              << archive.blocks().size() << " blocks\n" << std::defaultfloat;
+
+    auto timeSql = [&store, &seconds](const char* sql) {
+        auto begin = std::chrono::steady_clock::now();
+        sqlite3_exec(store.DB, sql, [](void*, int, char**, char**) { return 0; }, nullptr, nullptr);
+        return seconds(begin);
+    };
+    auto timeArchive = [&archive, &seconds](const HistoryQuery& query) {
+        std::map<std::string, ArchiveTickerTotals> totals;
+        auto begin = std::chrono::steady_clock::now();
+        summarizeArchive(archive, query, totals);
+        return seconds(begin);
+    };
+
+    HistoryQuery everything;
+    HistoryQuery oneTicker;
+    oneTicker.ticker = "SYM7";
+    std::cout << std::left << std::setw(24) << "QUERY" << std::setw(14) << "SQLITE (s)" << std::setw(14) << "ARCHIVE (s)" << "\n";
+    std::cout << std::string(52, '-') << "\n";
+    std::cout << std::left << std::fixed << std::setprecision(4)
+              << std::setw(24) << "summary, all tickers"
+              << std::setw(14) << timeSql("SELECT TICKER, COUNT(*), SUM(REMAINING > 0), SUM(QUANTITY), SUM(PRICE)"
+                                          " FROM ORDERS GROUP BY TICKER;")
+              << std::setw(14) << timeArchive(everything) << "\n"
+              << std::setw(24) << "summary, one ticker"
+              << std::setw(14) << timeSql("SELECT COUNT(*), SUM(REMAINING > 0), SUM(QUANTITY), SUM(PRICE)"
+                                          " FROM ORDERS WHERE TICKER = 'SYM7';")
+              << std::setw(14) << timeArchive(oneTicker) << "\n" << std::defaultfloat;
+
+    archive.close();
+    std::remove(BENCHMARK_ARCHIVE_PATH.c_str());
+    removeBenchmarkDB();
+}
+
+// Ticker validation through the cache, against a stand-in lookup that takes as long as a
+// Polygon round trip: the cost of a miss, of a cached answer, and how many lookups a burst
+// of concurrent callers asking about one new symbol makes
+inline void runTickerCacheBenchmark(std::size_t calls) {
+    const auto roundTrip = std::chrono::milliseconds(200);
+    std::atomic<int> lookups{0};
+    TickerValidationCache cache([&lookups, roundTrip](const std::string& ticker) {
+        ++lookups;
+        std::this_thread::sleep_for(roundTrip);
+        return ticker.rfind("BAD", 0) == 0 ? TickerStatus::INACTIVE : TickerStatus::ACTIVE;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    cache.validate("AAPL");
+    double missMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t active = 0;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < calls; ++i) {
+        active += cache.validate("AAPL");
+    }
+    double hitNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+
+    cache.validate("BADSYM");
+    int before = lookups;
+    bool negativeHit = !cache.validate("BADSYM") && lookups == before;
+
+    before = lookups;
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 16; ++t) {
+        callers.emplace_back([&cache] { cache.validate("MSFT"); });
+    }
+    for (std::thread& caller : callers) caller.join();
+
+    std::cout << "Ticker cache benchmark (lookup stand-in takes " << roundTrip.count() << " ms)\n"
+              << std::fixed << std::setprecision(1)
+              << "  miss                     " << missMs << " ms\n"
+              << "  hit                      " << hitNs << " ns (" << active << " of " << calls << " active)\n"
+              << "  unknown symbol, repeated " << (negativeHit ? "cached" : "looked up again") << "\n"
+              << "  16 concurrent callers    " << lookups - before << " lookup(s)\n" << std::defaultfloat;
+}
+
+// One GET on a fresh easy handle, set up and torn down around the request
+inline CURLcode fetchWithFreshHandle(const std::string& url, std::string& body) {
+    CURL* curl = curl_easy_init();
+    if (!curl) return CURLE_FAILED_INIT;
+    body.clear();
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, +[](void* contents, size_t size, size_t nmemb, void* userp) {
+        static_cast<std::string*>(userp)->append(static_cast<char*>(contents), size * nmemb);
+        return size * nmemb;
+    });
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+    CURLcode result = curl_easy_perform(curl);
+    curl_easy_cleanup(curl);
+    return result;
+}
+
+// Per-request latency of reference-data GETs against a local stand-in for Polygon, with a
+// new handle per request as before and with the pooled client: first on plain loopback,
+// then with a simulated 20 ms handshake per new connection, roughly what TCP and TLS
+// set-up cost against the real endpoint
+inline void runHttpBenchmark(std::size_t requests) {
+    const std::string reply = R"({"results":[{"ticker":"AAPL","market":"stocks","active":true}],"status":"OK"})";
+    std::cout << "Reference-data HTTP benchmark (" << requests << " requests per run)\n";
+    for (auto handshake : {std::chrono::microseconds(0), std::chrono::microseconds(20000)}) {
+        MockHttpServer server([&reply](const std::string&) { return reply; }, handshake);
+        if (!server.start()) {
+            std::cerr << "Could not start the mock HTTP server.\n";
+            return;
+        }
+        std::string url = server.baseUrl() + "/v3/reference/tickers?ticker=AAPL&market=stocks&active=true";
+        std::size_t count = handshake.count() > 0 ? std::min<std::size_t>(requests, 50) : requests;
+        std::string body;
+
+        auto timeRun = [&](auto&& fetch) {
+            std::size_t failures = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < count; ++i) {
+                failures += fetch(url, body) != CURLE_OK;
+            }
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / count;
+            if (failures > 0) std::cout << "  " << failures << " requests failed\n";
+            return us;
+        };
+
+        std::size_t before = server.connections();
+        double freshUs = timeRun(fetchWithFreshHandle);
+        std::size_t freshConnections = server.connections() - before;
+
+        HttpClient client;
+        before = server.connections();
+        double pooledUs = timeRun([&client](const std::string& target, std::string& out) { return client.get(target, out); });
+        std::size_t pooledConnections = server.connections() - before;
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  handshake " << handshake.count() / 1000 << " ms (" << count << " requests)\n"
+                  << "    new handle per request  " << std::setw(9) << freshUs << " us/request, "
+                  << freshConnections << " connections\n"
+                  << "    pooled handles          " << std::setw(9) << pooledUs << " us/request, "
+                  << pooledConnections << " connections\n"
+                  << "    saved                   " << std::setw(9) << freshUs - pooledUs << " us/request ("
+                  << std::setprecision(0) << 100.0 * (freshUs - pooledUs) / freshUs << "%)\n" << std::defaultfloat;
+    }
+}
+
+// An AlphaVantage TIME_SERIES_INTRADAY (5min) response with the given number of bars,
+// newest first as AlphaVantage sends them. The newest bar closes at 100 + bars / 100.
+inline std::string intradayResponse(const std::string& symbol, std::size_t bars) {
+    std::string body = R"json({"Meta Data":{"1. Information":"Intraday (5min) open, high, low, close prices and volume","2. Symbol":")json"
+        + symbol + R"json(","3. Last Refreshed":"2024-03-01 19:55:00","4. Interval":"5min","5. Output Size":"Full size",)json"
+        R"json("6. Time Zone":"US/Eastern"},"Time Series (5min)":{)json";
+    std::int64_t newest = 1709322900;  // 2024-03-01 19:55:00
+    char bar[256];
+    for (std::size_t i = 0; i < bars; ++i) {
+        std::time_t seconds = static_cast<std::time_t>(newest - static_cast<std::int64_t>(i) * 300);
+        std::tm tm{};
+        gmtime_r(&seconds, &tm);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+        double close = 100.0 + static_cast<double>(bars - i) / 100.0;
+        std::snprintf(bar, sizeof(bar),
+                      R"json(%s"%s":{"1. open":"%.4f","2. high":"%.4f","3. low":"%.4f","4. close":"%.4f","5. volume":"%zu"})json",
+                      i == 0 ? "" : ",", stamp, close - 0.02, close + 0.05, close - 0.05, close, 1000 + i);
+        body += bar;
+    }
+    body += "}}";
+    return body;
+}
+
+// The symbol in an AlphaVantage request target
+inline std::string requestedSymbol(const std::string& target) {
+    std::size_t start = target.find("symbol=");
+    if (start == std::string::npos) return "";
+    start += 7;
+    return target.substr(start, target.find('&', start) - start);
+}
+
+// Reference prices for a watchlist against a local stand-in for AlphaVantage that takes
+// 150 ms per request: fetching them one at a time with blocking requests, as the order
+// handlers used to, against the price service fetching them all concurrently, and the cost
+// of a handler reading a price from the service's cache and checking an order against it
+inline void runPriceServiceBenchmark(std::size_t tickers) {
+    const auto latency = std::chrono::milliseconds(150);
+    MockHttpServer server([](const std::string& target) { return intradayResponse(requestedSymbol(target), 100); },
+                          {}, latency);
+    if (!server.start()) {
+        std::cerr << "Could not start the mock HTTP server.\n";
+        return;
+    }
+    std::vector<std::string> symbols;
+    for (std::size_t i = 0; i < tickers; ++i) {
+        symbols.push_back("SYM" + std::to_string(i));
+    }
+
+    HttpClient client;
+    std::size_t parsed = 0;
+    std::string body;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& symbol : symbols) {
+        ReferencePrice price;
+        std::string error;
+        if (client.get(server.baseUrl() + "/query?function=TIME_SERIES_INTRADAY&symbol=" + symbol
+                       + "&interval=5min&apikey=demo", body) == CURLE_OK
+            && parseIntradayClose(body, price, error)) {
+            ++parsed;
+        }
+    }
+    double blockingMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    PriceServicePolicy policy;
+    policy.maxConcurrent = 16;
+    PriceService prices(server.baseUrl(), "demo", policy);
+    start = std::chrono::steady_clock::now();
+    prices.start();
+    for (const std::string& symbol : symbols) {
+        prices.watch(symbol);
+    }
+    while (prices.fetches() + prices.failures() < tickers
+           && std::chrono::steady_clock::now() - start < std::chrono::seconds(60)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double asyncMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const std::size_t reads = 10000000;
+    std::size_t found = 0;
+    double total = 0;
+    ReferencePrice price;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < reads; ++i) {
+        if (prices.latest(symbols[i % symbols.size()], price)) {
+            ++found;
+            total += price.close;
+        }
+    }
+    double readNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reads;
+
+    // Orders inside the band, the common case, and fat fingers at ten times the reference price
+    PriceBand band(prices, 10);
+    auto timeBand = [&](double orderPrice, std::size_t& refused) {
+        auto bandStart = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < reads; ++i) {
+            refused += !band.check(symbols[i % symbols.size()], orderPrice).empty();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - bandStart).count() / reads;
+    };
+    std::size_t insideRefused = 0, outsideRefused = 0;
+    double insideNs = timeBand(101.0, insideRefused);
+    double outsideNs = timeBand(1010.0, outsideRefused);
+    prices.stop();
+
+    std::cout << "Reference price benchmark (" << tickers << " tickers, stand-in takes " << latency.count() << " ms per request)\n"
+              << std::fixed << std::setprecision(1)
+              << "  blocking, one at a time     " << std::setw(8) << blockingMs << " ms (" << parsed << " prices)\n"
+              << "  price service, 16 in flight " << std::setw(8) << asyncMs << " ms (" << prices.fetches() << " prices, "
+              << prices.failures() << " failed)\n"
+              << "  handler read from cache     " << std::setw(8) << readNs << " ns (" << found << " of " << reads << " found)\n"
+              << "  10% band, inside            " << std::setw(8) << insideNs << " ns (" << insideRefused << " refused)\n"
+              << "  10% band, fat finger        " << std::setw(8) << outsideNs << " ns (" << outsideRefused << " refused, with message)\n"
+              << std::defaultfloat;
+    if (total < 0) std::cout << total;  // Keeps the reads from being optimized away
+}
+
+// The intraday close as it used to be read: parse the whole response into a json document,
+// copy the series out of it, then read one close
+inline bool parseIntradayCloseDocument(const std::string& body, ReferencePrice& price) {
+    auto responseJson = nlohmann::json::parse(body);
+    if (!responseJson.contains("Time Series (5min)")) return false;
+    auto timeSeries = responseJson["Time Series (5min)"];
+    if (timeSeries.empty()) return false;
+    auto newest = std::prev(timeSeries.end());
+    price.close = std::stod(newest.value()["4. close"].get<std::string>());
+    return parseBarTime(newest.key(), price.barTime);
+}
+
+// Time to read the latest close from AlphaVantage intraday responses of several sizes,
+// building a json document as before against the SAX handler that stops at the first bar
+inline void runIntradayParseBenchmark(std::size_t bars) {
+    std::cout << "Intraday response parse benchmark\n";
+    for (std::size_t size : {std::size_t(100), bars}) {
+        std::string body = intradayResponse("AAPL", size);
+        std::size_t iterations = std::max<std::size_t>(20, 2000000 / size);
+        ReferencePrice documentPrice, saxPrice;
+        std::string error;
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            parseIntradayCloseDocument(body, documentPrice);
+        }
+        double documentUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            parseIntradayClose(body, saxPrice, error);
+        }
+        double saxUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        bool agree = documentPrice.close == saxPrice.close && documentPrice.barTime == saxPrice.barTime;
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  " << size << " bars (" << body.size() / 1024 << " KB)\n"
+                  << "    json document  " << std::setw(9) << documentUs << " us\n"
+                  << "    SAX, first bar " << std::setw(9) << saxUs << " us (" << documentUs / saxUs << "x"
+                  << (agree ? "" : ", RESULTS DIFFER") << ")\n" << std::defaultfloat;
+    }
+}
+
+// Prices and quantities as they used to be parsed at the prompt: filter the text into a new
+// string, then std::stod, catching its exception
+inline double parseDoubleWithStod(const std::string& input) {
+    std::string cleaned;
+    cleaned.reserve(input.size());
+    std::copy_if(input.begin(), input.end(), std::back_inserter(cleaned),
+                 [](char c) { return (std::isdigit(c) || c == '.' || c == '-'); });
+    try {
+        return std::stod(cleaned);
+    } catch (const std::exception&) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+// Time to parse typical prices and quantities, some with thousands separators, with stod
+// and with the from_chars decimal parser, and to turn the result into whole ticks
+inline void runNumberParseBenchmark(std::size_t numbers) {
+    std::vector<std::string> inputs;
+    inputs.reserve(numbers);
+    for (std::size_t i = 0; i < numbers; ++i) {
+        std::size_t cents = 1000 + (i * 7919) % 5000000;
+        std::string whole = std::to_string(cents / 100);
+        if (i % 4 == 0 && whole.size() > 3) whole.insert(whole.size() - 3, ",");
+        std::string fraction = std::to_string(100 + cents % 100).substr(1);
+        inputs.push_back(i % 3 == 0 ? whole : whole + "." + fraction);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    double stodTotal = 0;
+    for (const std::string& input : inputs) {
+        stodTotal += parseDoubleWithStod(input);
+    }
+    double stodNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numbers;
+
+    start = std::chrono::steady_clock::now();
+    double decimalTotal = 0;
+    std::size_t failed = 0;
+    for (const std::string& input : inputs) {
+        Decimal value;
+        if (parseDecimal(input, value)) {
+            decimalTotal += toDouble(value);
+        } else {
+            ++failed;
+        }
+    }
+    double decimalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numbers;
+
+    const Decimal tick{1, 2};
+    start = std::chrono::steady_clock::now();
+    std::int64_t tickTotal = 0;
+    for (const std::string& input : inputs) {
+        Decimal value;
+        std::int64_t ticks = 0;
+        if (parseDecimal(input, value) && toIncrements(value, tick, ticks)) {
+            tickTotal += ticks;
+        }
+    }
+    double ticksNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numbers;
+
+    bool agree = failed == 0 && std::fabs(stodTotal - decimalTotal) <= 1e-9 * std::fabs(stodTotal)
+                 && std::llround(decimalTotal * 100) == tickTotal;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Number parse benchmark (" << numbers << " prices and quantities, a quarter with separators)\n"
+              << "  filter + std::stod      " << std::setw(6) << stodNs << " ns\n"
+              << "  from_chars decimal      " << std::setw(6) << decimalNs << " ns (" << stodNs / decimalNs << "x)\n"
+              << "  from_chars to 0.01 ticks " << std::setw(5) << ticksNs << " ns"
+              << (agree ? "" : " (RESULTS DIFFER)") << "\n" << std::defaultfloat;
+}
+
+#endif // BENCHMARK_H
@@ -0,0 +1,79 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "orderbook.hpp"
+
+// Kind of work carried by a command record
+enum class CommandType : std::uint8_t {
+    ADD,     // New order, matched and then rested
+    CANCEL,  // Remove a resting order by ID
+    MODIFY,  // Change price and/or quantity of a resting order
+    QUERY,   // Print the active orders for a ticker
+    BARRIER  // Internal: parks a shard while the sequencer runs exclusive work
+};
+
+// Maximum ticker length (including the terminating null) carried in a command
+constexpr std::size_t COMMAND_TICKER_SIZE = 16;
+
+// Plain, fixed-layout command passed by value through the matching ring.
+// Fields that do not apply to a command type are left zeroed.
+struct Command {
+    std::uint64_t sequence;  // Stamped by the sequencer at ingress
+    CommandType type;
+    Side side;
+    int orderId;
+    double price;
+    double quantity;
+    char ticker[COMMAND_TICKER_SIZE];
+
+    // Copy a ticker into the fixed-size field; fails if it does not fit
+    bool setTicker(std::string_view value) {
+        if (value.size() >= COMMAND_TICKER_SIZE) {
+            return false;
+        }
+        std::memcpy(ticker, value.data(), value.size());
+        ticker[value.size()] = '\0';
+        return true;
+    }
+};
+
+// Build an ADD command for a new order
+inline bool makeAddCommand(Side side, double price, double quantity, std::string_view ticker, Command& command) {
+    command = Command{};
+    command.type = CommandType::ADD;
+    command.side = side;
+    command.price = price;
+    command.quantity = quantity;
+    return command.setTicker(ticker);
+}
+
+// Build a CANCEL command for a resting order
+inline Command makeCancelCommand(int orderId) {
+    Command command{};
+    command.type = CommandType::CANCEL;
+    command.orderId = orderId;
+    return command;
+}
+
+// Build a MODIFY command that replaces price and quantity of a resting order
+inline Command makeModifyCommand(int orderId, double price, double quantity) {
+    Command command{};
+    command.type = CommandType::MODIFY;
+    command.orderId = orderId;
+    command.price = price;
+    command.quantity = quantity;
+    return command;
+}
+
+// Build a QUERY command listing active orders for a ticker
+inline bool makeQueryCommand(const std::string& ticker, Command& command) {
+    command = Command{};
+    command.type = CommandType::QUERY;
+    return command.setTicker(ticker);
+}
+
+#endif // COMMAND_H
@@ -0,0 +1,303 @@
+#ifndef COMPACTION_H
+#define COMPACTION_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "sqlitestore.hpp"
+#include "historyquery.hpp"
+#include "archive.hpp"
+
+// How much history the compaction job keeps live, and how gently it removes the rest
+struct CompactionPolicy {
+    std::chrono::hours olderThan{24 * 7};      // Terminal orders created before now - olderThan are archived
+    std::size_t maxRowsPerRun = 1000000;       // Rows archived by one run; the rest wait for the next
+    std::size_t batchRows = 500;               // Rows deleted per transaction
+    std::size_t rowsPerSecond = 20000;         // Deletion rate limit
+    int vacuumPages = 256;                     // Pages returned to the OS per incremental vacuum step
+    std::chrono::seconds interval{3600};       // Time between background runs
+    std::chrono::milliseconds promptRun{1000};  // Rough limit on a run made on the prompt thread
+};
+
+// What one compaction run did
+struct CompactionResult {
+    std::string archivePath;  // Empty if nothing was archived
+    std::size_t archived = 0;
+    std::size_t deleted = 0;
+    long long pagesFreed = 0;
+    bool more = false;  // The run stopped at its row limit; older orders are left for the next
+};
+
+// Moves old terminal orders out of the live SQLite history into archive files.
+// Cancelled orders are already deleted from ORDERS when cancelled, so terminal here means
+// fully filled (REMAINING = 0). A run has three phases:
+//   1. Copy matching rows, sorted by ticker, into a new archive in the archive directory.
+//      This reads on its own read-only connection from a WAL snapshot, without blocking anyone.
+//   2. Once the archive is synced, delete exactly the archived orders from ORDERS in small
+//      transactions on the store's connection, pausing between them to stay under the rate limit.
+//   3. Hand freed pages back with incremental vacuum, a few at a time.
+// Phases 2 and 3 hold the store's dbMutex one short step at a time, so the persistence
+// writer never waits for more than one batch. TRADES is left alone.
+class HistoryCompactor {
+public:
+    HistoryCompactor(SqliteStore& store, std::string directory, CompactionPolicy policy = {})
+        : store_(store), directory_(std::move(directory)), policy_(policy) {}
+
+    ~HistoryCompactor() {
+        stop();
+    }
+
+    HistoryCompactor(const HistoryCompactor&) = delete;
+    HistoryCompactor& operator=(const HistoryCompactor&) = delete;
+
+    // Run every policy.interval on a background thread, starting one interval from now
+    void start() {
+        if (thread_.joinable()) return;
+        stopping_ = false;
+        thread_ = std::thread([this] {
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            while (true) {
+                wakeCv_.wait_for(lock, policy_.interval, [this] { return stopping_ || wakeRequested_; });
+                if (stopping_) break;
+                bool requested = std::exchange(wakeRequested_, false);
+                lock.unlock();
+                CompactionResult result = runOnce();
+                if (requested && result.archived == 0 && result.pagesFreed == 0) {
+                    std::cout << "Compaction: nothing to compact.\n";
+                }
+                report(result);
+                lock.lock();
+            }
+        });
+    }
+
+    // Stop the background thread; a run in progress stops at its next step
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            stopping_ = true;
+        }
+        wakeCv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // Start a background run now rather than at the next interval; it reports when done.
+    // False if the background thread is not running.
+    bool wake() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            if (!thread_.joinable() || stopping_) return false;
+            wakeRequested_ = true;
+        }
+        wakeCv_.notify_all();
+        return true;
+    }
+
+    // Compact now, on the calling thread. Runs never overlap.
+    CompactionResult runOnce() {
+        return runOnce(policy_.maxRowsPerRun);
+    }
+
+    // Compact now, on the calling thread, archiving only as many orders as the rate limit
+    // deletes in policy.promptRun, so the caller gets control back quickly
+    CompactionResult runBriefly() {
+        auto rows = static_cast<std::size_t>(static_cast<double>(policy_.rowsPerSecond)
+                                             * std::chrono::duration<double>(policy_.promptRun).count());
+        return runOnce(std::min(std::max(rows, policy_.batchRows), policy_.maxRowsPerRun));
+    }
+
+    // As runOnce(), archiving at most maxRows orders
+    CompactionResult runOnce(std::size_t maxRows) {
+        std::lock_guard<std::mutex> runLock(runMutex_);
+        CompactionResult result;
+        std::vector<int> orderIds;
+        if (!archiveOldOrders(maxRows, result, orderIds)) {
+            return result;
+        }
+        result.deleted = deleteOrders(orderIds);
+        result.pagesFreed = vacuum();
+        return result;
+    }
+
+    static void report(const CompactionResult& result) {
+        if (result.archived == 0 && result.pagesFreed == 0) return;
+        std::cout << "Compaction: archived " << result.archived << " orders"
+                  << (result.archivePath.empty() ? "" : " to " + result.archivePath)
+                  << ", deleted " << result.deleted << ", freed " << result.pagesFreed << " pages"
+                  << (result.more ? "; more remain for the next run.\n" : ".\n");
+    }
+
+private:
+    // Phase 1: write up to maxRows candidates to a new archive; orderIds receives what it holds
+    bool archiveOldOrders(std::size_t maxRows, CompactionResult& result, std::vector<int>& orderIds) {
+        HistoryReader reader;
+        if (!reader.open(store_.dbPath)) {
+            return false;
+        }
+        ReadSnapshot snapshot(reader.handle());
+
+        auto cutoff = std::chrono::duration_cast<std::chrono::milliseconds>(
+            (std::chrono::system_clock::now() - policy_.olderThan).time_since_epoch()).count();
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_prepare_v2(reader.handle(),
+                "SELECT ORDER_ID, TICKER, PRICE, QUANTITY, REMAINING, SIDE, CREATED_AT FROM ORDERS "
+                "WHERE REMAINING <= 0 AND CREATED_AT < ? ORDER BY TICKER, ORDER_ID LIMIT ?;",
+                -1, &statement, nullptr) != SQLITE_OK) {
+            std::cerr << "Error preparing compaction query: " << sqlite3_errmsg(reader.handle()) << std::endl;
+            return false;
+        }
+        sqlite3_bind_int64(statement, 1, static_cast<sqlite3_int64>(cutoff));
+        sqlite3_bind_int64(statement, 2, static_cast<sqlite3_int64>(maxRows));
+
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        std::string path = directory_ + "/orders-"
+            + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch()).count())
+            + ".obarc";
+        ArchiveWriter writer;
+        if (!writer.open(path)) {
+            sqlite3_finalize(statement);
+            return false;
+        }
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            const unsigned char* ticker = sqlite3_column_text(statement, 1);
+            HistoryRow row{
+                sqlite3_column_int(statement, 0),
+                ticker ? reinterpret_cast<const char*>(ticker) : "",
+                sqlite3_column_double(statement, 2),
+                sqlite3_column_double(statement, 3),
+                sqlite3_column_double(statement, 4),
+                sqlite3_column_int(statement, 5) == 0 ? Side::BUY : Side::SELL,
+                sqlite3_column_int64(statement, 6)};
+            writer.add(row);
+            orderIds.push_back(row.orderId);
+        }
+        sqlite3_finalize(statement);
+
+        if (orderIds.empty()) {
+            std::remove((path + ".tmp").c_str());
+            return true;
+        }
+        if (!writer.finish()) {
+            orderIds.clear();
+            return false;
+        }
+        result.archivePath = path;
+        result.archived = orderIds.size();
+        result.more = orderIds.size() >= maxRows;
+        return true;
+    }
+
+    // Phase 2: delete the archived orders in rate-limited batches. Only rows that are still
+    // terminal are deleted, so an order that changed since it was archived stays live.
+    std::size_t deleteOrders(std::vector<int>& orderIds) {
+        std::sort(orderIds.begin(), orderIds.end());
+        auto batchBudget = std::chrono::duration<double>(
+            static_cast<double>(policy_.batchRows) / static_cast<double>(std::max<std::size_t>(policy_.rowsPerSecond, 1)));
+
+        std::size_t deleted = 0;
+        for (std::size_t begin = 0; begin < orderIds.size() && !stopRequested(); begin += policy_.batchRows) {
+            auto started = std::chrono::steady_clock::now();
+            std::size_t end = std::min(orderIds.size(), begin + policy_.batchRows);
+            {
+                std::lock_guard<std::mutex> dbLock(store_.dbMutex);
+                sqlite3_stmt* statement = nullptr;
+                sqlite3_exec(store_.DB, "BEGIN;", nullptr, nullptr, nullptr);
+                sqlite3_prepare_v2(store_.DB, "DELETE FROM ORDERS WHERE ORDER_ID = ? AND REMAINING <= 0;",
+                                   -1, &statement, nullptr);
+                for (std::size_t i = begin; statement && i < end; ++i) {
+                    sqlite3_bind_int(statement, 1, orderIds[i]);
+                    if (sqlite3_step(statement) == SQLITE_DONE) {
+                        deleted += static_cast<std::size_t>(sqlite3_changes(store_.DB));
+                    }
+                    sqlite3_reset(statement);
+                }
+                sqlite3_finalize(statement);
+                if (sqlite3_exec(store_.DB, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+                    std::cerr << "Error committing compaction batch: " << sqlite3_errmsg(store_.DB) << std::endl;
+                    sqlite3_exec(store_.DB, "ROLLBACK;", nullptr, nullptr, nullptr);
+                }
+            }
+            pause(batchBudget - (std::chrono::steady_clock::now() - started));
+        }
+        return deleted;
+    }
+
+    // Phase 3: return free pages a step at a time. Databases created before incremental
+    // auto-vacuum was enabled keep their free pages for reuse instead.
+    long long vacuum() {
+        if (pragmaValue("auto_vacuum") != 2) {
+            if (!vacuumWarned_) {
+                std::cout << "Compaction: " << store_.dbPath << " predates incremental vacuum; freed pages are reused "
+                          << "but not returned. Run \"PRAGMA auto_vacuum=INCREMENTAL; VACUUM;\" on it offline to change that.\n";
+                vacuumWarned_ = true;
+            }
+            return 0;
+        }
+        long long start = pragmaValue("freelist_count");
+        long long remaining = start;
+        while (remaining > 0 && !stopRequested()) {
+            {
+                std::lock_guard<std::mutex> dbLock(store_.dbMutex);
+                std::string sql = "PRAGMA incremental_vacuum(" + std::to_string(policy_.vacuumPages) + ");";
+                sqlite3_exec(store_.DB, sql.c_str(), nullptr, nullptr, nullptr);
+            }
+            long long now = pragmaValue("freelist_count");
+            if (now >= remaining) break;
+            remaining = now;
+            pause(std::chrono::milliseconds(10));
+        }
+        return start - std::max(remaining, 0LL);
+    }
+
+    long long pragmaValue(const char* pragma) {
+        std::lock_guard<std::mutex> dbLock(store_.dbMutex);
+        long long value = -1;
+        sqlite3_stmt* statement = nullptr;
+        std::string sql = std::string("PRAGMA ") + pragma + ";";
+        if (sqlite3_prepare_v2(store_.DB, sql.c_str(), -1, &statement, nullptr) == SQLITE_OK
+            && sqlite3_step(statement) == SQLITE_ROW) {
+            value = sqlite3_column_int64(statement, 0);
+        }
+        sqlite3_finalize(statement);
+        return value;
+    }
+
+    bool stopRequested() {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        return stopping_;
+    }
+
+    // Sleep for the given time, waking early if stop() is called
+    template <typename Duration>
+    void pause(Duration duration) {
+        if (duration <= Duration::zero()) return;
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wakeCv_.wait_for(lock, duration, [this] { return stopping_; });
+    }
+
+    SqliteStore& store_;
+    std::string directory_;
+    CompactionPolicy policy_;
+    std::mutex runMutex_;  // Serializes background and on-demand runs
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    bool stopping_ = false;
+    bool wakeRequested_ = false;  // "compact history" asked the background thread for a run
+    bool vacuumWarned_ = false;
+    std::thread thread_;
+};
+
+#endif // COMPACTION_H
@@ -0,0 +1,272 @@
+#ifndef HISTORYQUERY_H
+#define HISTORYQUERY_H
+
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sqlite3.h>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "numparse.hpp"
+#include "orderbook.hpp"
+#include "statementcache.hpp"
+
+// Filters for browsing order history; unset fields match every order
+struct HistoryQuery {
+    std::string ticker;           // Empty matches any ticker
+    std::optional<Side> side;
+    int minOrderId = 0;           // Inclusive bounds; 0 leaves the bound open
+    int maxOrderId = 0;
+    std::int64_t fromTime = 0;    // CREATED_AT bounds in ms since the epoch; 0 leaves the bound open
+    std::int64_t toTime = 0;
+    std::size_t pageSize = 20;
+};
+
+// Largest page a history query may ask for
+constexpr std::size_t HISTORY_MAX_PAGE_SIZE = 1000;
+
+// One ORDERS row as seen by a history query
+struct HistoryRow {
+    int orderId;
+    std::string ticker;
+    double price;
+    double quantity;
+    double remaining;
+    Side side;
+    std::int64_t createdAt;
+};
+
+// A page of results. Pass lastOrderId as afterOrderId to fetch the next page.
+struct HistoryPage {
+    std::vector<HistoryRow> rows;
+    int lastOrderId = 0;
+    bool hasMore = false;
+};
+
+// Parse "YYYY-MM-DD" or "YYYY-MM-DDTHH:MM[:SS]" (UTC) into ms since the epoch
+inline bool parseHistoryTime(const std::string& text, std::int64_t& millis) {
+    for (const char* format : {"%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d"}) {
+        std::istringstream in(text);
+        std::tm tm{};
+        in >> std::get_time(&tm, format);
+        if (!in.fail() && in.peek() == std::char_traits<char>::eof()) {
+            millis = static_cast<std::int64_t>(timegm(&tm)) * 1000;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Format ms since the epoch as "YYYY-MM-DD HH:MM:SS" (UTC); 0 means unknown
+inline std::string formatHistoryTime(std::int64_t millis) {
+    if (millis == 0) return "-";
+    std::time_t seconds = static_cast<std::time_t>(millis / 1000);
+    std::tm tm{};
+    gmtime_r(&seconds, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    return buffer;
+}
+
+// Parse a filter line such as "ticker=AAPL side=buy from-id=10 to-id=500 since=2024-01-02 until=2024-01-02T16:00".
+// An unknown key or bad value is reported and makes the whole line invalid; page= takes
+// 1 to HISTORY_MAX_PAGE_SIZE rows.
+inline bool parseHistoryQuery(const std::string& line, HistoryQuery& query) {
+    std::istringstream in(line);
+    std::string term;
+    while (in >> term) {
+        auto equals = term.find('=');
+        std::string key = term.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : term.substr(equals + 1);
+
+        bool ok = !value.empty();
+        if (!ok) {
+            // Missing value
+        } else if (key == "ticker") {
+            query.ticker = value;
+        } else if (key == "side") {
+            ok = value == "buy" || value == "sell";
+            query.side = value == "buy" ? Side::BUY : Side::SELL;
+        } else if (key == "from-id") {
+            ok = parseInteger(value, query.minOrderId) && query.minOrderId >= 0;
+        } else if (key == "to-id") {
+            ok = parseInteger(value, query.maxOrderId) && query.maxOrderId >= 0;
+        } else if (key == "since") {
+            ok = parseHistoryTime(value, query.fromTime);
+        } else if (key == "until") {
+            ok = parseHistoryTime(value, query.toTime);
+        } else if (key == "page") {
+            ok = parseInteger(value, query.pageSize) && query.pageSize > 0 && query.pageSize <= HISTORY_MAX_PAGE_SIZE;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cout << "Invalid filter '" << term << "'.\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Print a page of history rows as a table
+inline void printHistoryPage(const HistoryPage& page) {
+    std::cout << std::left
+              << std::setw(10) << "ORDER_ID"
+              << std::setw(12) << "TICKER"
+              << std::setw(12) << "PRICE"
+              << std::setw(12) << "QUANTITY"
+              << std::setw(12) << "REMAINING"
+              << std::setw(8) << "SIDE"
+              << std::setw(20) << "CREATED (UTC)" << std::endl;
+    std::cout << std::string(86, '-') << std::endl;
+    for (const HistoryRow& row : page.rows) {
+        std::cout << std::left
+                  << std::setw(10) << row.orderId
+                  << std::setw(12) << row.ticker
+                  << std::setw(12) << row.price
+                  << std::setw(12) << row.quantity
+                  << std::setw(12) << row.remaining
+                  << std::setw(8) << (row.side == Side::BUY ? "BUY" : "SELL")
+                  << std::setw(20) << formatHistoryTime(row.createdAt) << std::endl;
+    }
+}
+
+// Read-only view of order history on its own SQLite connection. Under WAL it never waits
+// for the persistence writer, and it never takes the store's dbMutex, so browsing history
+// does not hold up matching. Results are keyset-paginated on ORDER_ID: each page is an
+// index range scan that starts after the previous page, however deep the caller pages.
+// Not thread-safe; use one reader per thread.
+class HistoryReader {
+public:
+    ~HistoryReader() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        if (sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            std::cerr << "Failed to open " << path << " for reading: " << sqlite3_errmsg(db_) << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        for (auto& [mask, cached] : statements_) {
+            cached.finalize();
+        }
+        statements_.clear();
+        sqlite3_close(db_);
+        db_ = nullptr;
+    }
+
+    [[nodiscard]] sqlite3* handle() const { return db_; }
+
+    // Orders matching the query with ORDER_ID greater than afterOrderId, in ORDER_ID order
+    HistoryPage page(const HistoryQuery& query, int afterOrderId) {
+        HistoryPage result;
+        CachedStatement* cached = statementFor(query);
+        if (!cached || !cached->statement) {
+            return result;
+        }
+
+        StatementRun run(*cached);
+        sqlite3_stmt* statement = run.get();
+        int index = 1;
+        sqlite3_bind_int(statement, index++, afterOrderId);
+        if (!query.ticker.empty()) sqlite3_bind_text(statement, index++, query.ticker.c_str(), -1, SQLITE_TRANSIENT);
+        if (query.side) sqlite3_bind_int(statement, index++, static_cast<int>(*query.side));
+        if (query.minOrderId) sqlite3_bind_int(statement, index++, query.minOrderId);
+        if (query.maxOrderId) sqlite3_bind_int(statement, index++, query.maxOrderId);
+        if (query.fromTime) sqlite3_bind_int64(statement, index++, query.fromTime);
+        if (query.toTime) sqlite3_bind_int64(statement, index++, query.toTime);
+        // One extra row tells us whether another page follows
+        sqlite3_bind_int64(statement, index, static_cast<sqlite3_int64>(query.pageSize + 1));
+
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            if (result.rows.size() == query.pageSize) {
+                result.hasMore = true;
+                break;
+            }
+            const unsigned char* ticker = sqlite3_column_text(statement, 1);
+            result.rows.push_back({
+                sqlite3_column_int(statement, 0),
+                ticker ? reinterpret_cast<const char*>(ticker) : "",
+                sqlite3_column_double(statement, 2),
+                sqlite3_column_double(statement, 3),
+                sqlite3_column_double(statement, 5),
+                sqlite3_column_int(statement, 4) == 0 ? Side::BUY : Side::SELL,
+                sqlite3_column_int64(statement, 6)});
+        }
+        if (!result.rows.empty()) {
+            result.lastOrderId = result.rows.back().orderId;
+        }
+        return result;
+    }
+
+private:
+    // One prepared statement per combination of filters in use, so each can use its own index
+    CachedStatement* statementFor(const HistoryQuery& query) {
+        unsigned mask = (!query.ticker.empty() ? 1u : 0u) | (query.side ? 2u : 0u)
+                      | (query.minOrderId ? 4u : 0u) | (query.maxOrderId ? 8u : 0u)
+                      | (query.fromTime ? 16u : 0u) | (query.toTime ? 32u : 0u);
+        auto it = statements_.find(mask);
+        if (it != statements_.end()) {
+            return &it->second;
+        }
+
+        std::string sql = "SELECT ORDER_ID, TICKER, PRICE, QUANTITY, SIDE, REMAINING, CREATED_AT "
+                          "FROM ORDERS WHERE ORDER_ID > ?";
+        if (mask & 1u) sql += " AND TICKER = ?";
+        if (mask & 2u) sql += " AND SIDE = ?";
+        if (mask & 4u) sql += " AND ORDER_ID >= ?";
+        if (mask & 8u) sql += " AND ORDER_ID <= ?";
+        if (mask & 16u) sql += " AND CREATED_AT >= ?";
+        if (mask & 32u) sql += " AND CREATED_AT > 0 AND CREATED_AT <= ?";
+        sql += " ORDER BY ORDER_ID LIMIT ?;";
+
+        CachedStatement& cached = statements_[mask];
+        if (!db_ || !cached.prepare(db_, "history#" + std::to_string(mask), sql.c_str())) {
+            statements_.erase(mask);
+            return nullptr;
+        }
+        return &cached;
+    }
+
+    sqlite3* db_ = nullptr;
+    std::unordered_map<unsigned, CachedStatement> statements_;
+};
+
+// Pins a WAL read snapshot on a read-only connection. Every query made while it lives sees
+// the database as of the moment it was taken, however much the writer commits meanwhile,
+// and neither side waits for the other. Keep it short-lived: checkpoints cannot move past
+// an open snapshot, so the WAL grows while it is held.
+class ReadSnapshot {
+public:
+    explicit ReadSnapshot(sqlite3* db) : db_(db) {
+        if (!db_ || sqlite3_exec(db_, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            db_ = nullptr;
+            return;
+        }
+        // A WAL read transaction starts at its first read, so read something now
+        sqlite3_exec(db_, "SELECT 1 FROM sqlite_master LIMIT 1;", nullptr, nullptr, nullptr);
+    }
+
+    ~ReadSnapshot() {
+        if (db_) {
+            sqlite3_exec(db_, "COMMIT;", nullptr, nullptr, nullptr);
+        }
+    }
+
+    ReadSnapshot(const ReadSnapshot&) = delete;
+    ReadSnapshot& operator=(const ReadSnapshot&) = delete;
+
+private:
+    sqlite3* db_;
+};
+
+#endif // HISTORYQUERY_H
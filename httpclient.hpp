@@ -0,0 +1,130 @@
+#ifndef HTTPCLIENT_H
+#define HTTPCLIENT_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <curl/curl.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// HTTP GETs to one endpoint over reused connections.
+// Easy handles are kept in a pool instead of being created and cleaned up per request:
+// a handle keeps its open connections between requests, so a repeat request to the same
+// host skips the TCP and TLS handshakes. All handles of a client also share a DNS cache and
+// a TLS session cache, so a handle opening its first connection (when several requests run
+// at once) skips the lookup and resumes the TLS session instead of negotiating a new one.
+// Connection caches stay per handle: a shared one was found to close most connections
+// under concurrent use instead of reusing them.
+// Thread-safe; one client per endpoint keeps each pool's connections pointed at one host.
+class HttpClient {
+public:
+    explicit HttpClient(std::size_t maxIdleHandles = 8) : maxIdle_(maxIdleHandles) {
+        share_ = curl_share_init();
+        if (share_) {
+            curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lockShared);
+            curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlockShared);
+            curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+    }
+
+    ~HttpClient() {
+        for (CURL* handle : idle_) {
+            curl_easy_cleanup(handle);
+        }
+        if (share_) {
+            curl_share_cleanup(share_);
+        }
+    }
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // Fetch url into body. Returns the transfer result; HTTP error statuses are not failures here.
+    CURLcode get(const std::string& url, std::string& body) {
+        CURL* handle = acquire();
+        if (!handle) {
+            return CURLE_FAILED_INIT;
+        }
+        body.clear();
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, appendBody);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &body);
+        CURLcode result = curl_easy_perform(handle);
+
+        long connects = 0;
+        curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        connections_.fetch_add(static_cast<std::size_t>(connects), std::memory_order_relaxed);
+        release(handle);
+        return result;
+    }
+
+    // Requests made, and how many of them had to open a new connection
+    [[nodiscard]] std::size_t requests() const { return requests_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::size_t connections() const { return connections_.load(std::memory_order_relaxed); }
+
+private:
+    CURL* acquire() {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex_);
+            if (!idle_.empty()) {
+                CURL* handle = idle_.back();
+                idle_.pop_back();
+                return handle;
+            }
+        }
+        CURL* handle = curl_easy_init();
+        if (handle) {
+            configure(handle);
+        }
+        return handle;
+    }
+
+    // Return a handle to the pool. Resetting clears the last request's options but keeps
+    // the handle's connections and caches.
+    void release(CURL* handle) {
+        curl_easy_reset(handle);
+        configure(handle);
+        std::lock_guard<std::mutex> lock(poolMutex_);
+        if (idle_.size() < maxIdle_) {
+            idle_.push_back(handle);
+            return;
+        }
+        curl_easy_cleanup(handle);
+    }
+
+    void configure(CURL* handle) {
+        if (share_) {
+            curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+        }
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);  // Handles are used from several threads
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    }
+
+    static size_t appendBody(void* contents, size_t size, size_t nmemb, void* userp) {
+        static_cast<std::string*>(userp)->append(static_cast<char*>(contents), size * nmemb);
+        return size * nmemb;
+    }
+
+    static void lockShared(CURL*, curl_lock_data data, curl_lock_access, void* userp) {
+        static_cast<HttpClient*>(userp)->shareLocks_[static_cast<std::size_t>(data)].lock();
+    }
+
+    static void unlockShared(CURL*, curl_lock_data data, void* userp) {
+        static_cast<HttpClient*>(userp)->shareLocks_[static_cast<std::size_t>(data)].unlock();
+    }
+
+    std::size_t maxIdle_;
+    CURLSH* share_ = nullptr;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> shareLocks_;
+    std::mutex poolMutex_;
+    std::vector<CURL*> idle_;
+    std::atomic<std::size_t> requests_{0};
+    std::atomic<std::size_t> connections_{0};
+};
+
+#endif // HTTPCLIENT_H
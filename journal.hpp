@@ -0,0 +1,393 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+#include "orderbook.hpp"
+#include "ringbuffer.hpp"
+
+// CRC32C (Castagnoli), table-driven, eight bytes per step
+inline std::uint32_t crc32cSoftware(std::uint32_t crc, const unsigned char* bytes, std::size_t length) {
+    static constexpr auto tables = [] {
+        std::array<std::array<std::uint32_t, 256>, 8> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            t[0][i] = c;
+        }
+        for (std::size_t n = 1; n < 8; ++n) {
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                t[n][i] = (t[n - 1][i] >> 8) ^ t[0][t[n - 1][i] & 0xFF];
+            }
+        }
+        return t;
+    }();
+
+    for (; length >= 8; bytes += 8, length -= 8) {
+        std::uint32_t low;
+        std::uint32_t high;
+        std::memcpy(&low, bytes, 4);
+        std::memcpy(&high, bytes + 4, 4);
+        low ^= crc;
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24]
+            ^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+    }
+    for (; length > 0; ++bytes, --length) crc = tables[0][(crc ^ *bytes) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+// CRC32C with the SSE4.2 instruction; only called after a runtime CPU check
+__attribute__((target("sse4.2")))
+inline std::uint32_t crc32cHardware(std::uint32_t crc, const unsigned char* bytes, std::size_t length) {
+    for (; length >= 8; bytes += 8, length -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        crc = static_cast<std::uint32_t>(__builtin_ia32_crc32di(crc, word));
+    }
+    for (; length > 0; ++bytes, --length) crc = __builtin_ia32_crc32qi(crc, *bytes);
+    return crc;
+}
+#endif
+
+// CRC32C of a buffer, using the CPU instruction where available
+inline std::uint32_t crc32c(const void* data, std::size_t length) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    static const bool hardware = __builtin_cpu_supports("sse4.2");
+    if (hardware) {
+        return crc32cHardware(0xFFFFFFFFu, bytes, length) ^ 0xFFFFFFFFu;
+    }
+#elif defined(__ARM_FEATURE_CRC32)
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (; length >= 8; bytes += 8, length -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        crc = __crc32cd(crc, word);
+    }
+    for (; length > 0; ++bytes, --length) crc = __crc32cb(crc, *bytes);
+    return crc ^ 0xFFFFFFFFu;
+#endif
+    return crc32cSoftware(0xFFFFFFFFu, bytes, length) ^ 0xFFFFFFFFu;
+}
+
+// One journal entry, exactly one cache line. The length prefix is written last,
+// so a record is only considered present once it is complete.
+struct JournalRecord {
+    std::uint32_t length;    // Total record size in bytes; 0 marks the end of the journal
+    std::uint32_t checksum;  // CRC32C of everything after this field
+    std::uint64_t sequence;
+    PersistEventType type;
+    Side side;
+    std::int32_t orderId;
+    std::int32_t matchedOrderId;
+    double price;
+    double quantity;
+    char ticker[TICKER_SIZE];
+};
+static_assert(sizeof(JournalRecord) == 64, "Journal records are expected to fill one cache line");
+
+// File header, stored in the first cache line of the journal
+struct JournalHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t baseSequence;  // Sequence number of the first record slot
+    char reserved[40];
+};
+static_assert(sizeof(JournalHeader) == 64, "Journal header must fill one cache line");
+
+constexpr char JOURNAL_MAGIC[8] = {'O', 'B', 'J', 'R', 'N', 'L', '0', '1'};
+constexpr std::size_t JOURNAL_CHUNK_BYTES = 64ull * 1024 * 1024;    // Preallocation step
+constexpr std::size_t JOURNAL_MAX_BYTES = 64ull * 1024 * 1024 * 1024; // Address space reserved up front
+
+// Append-only binary log of every order event (add, cancel, modify, trade).
+// The file is preallocated in large chunks and mapped once, so an append is an atomic
+// slot reservation plus a 64-byte copy into the page cache. Events are then forwarded
+// downstream (the asynchronous SQLite writer), which makes SQLite a derived store.
+class EventJournal : public EventPublisher {
+public:
+    EventPublisher* downstream = nullptr;
+
+    EventJournal() = default;
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    ~EventJournal() override {
+        close();
+    }
+
+    // Open or create a journal. A new journal starts numbering at firstSequence, so it
+    // never reuses sequence numbers already present in a derived store.
+    bool open(const std::string& path, std::uint64_t firstSequence = 1) {
+        path_ = path;
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) {
+            std::cerr << "Failed to open journal " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        struct stat info{};
+        fstat(fd_, &info);
+        void* mapped = mmap(nullptr, JOURNAL_MAX_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Failed to map journal " << path << ": " << std::strerror(errno) << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        base_ = static_cast<char*>(mapped);
+        allocated_.store(static_cast<std::size_t>(info.st_size), std::memory_order_release);
+
+        auto* header = reinterpret_cast<JournalHeader*>(base_);
+        if (static_cast<std::size_t>(info.st_size) < sizeof(JournalHeader)) {
+            grow(sizeof(JournalHeader) + sizeof(JournalRecord));
+            std::memcpy(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+            header->version = 1;
+            header->recordSize = sizeof(JournalRecord);
+            header->baseSequence = firstSequence;
+        } else if (std::memcmp(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0
+                   || header->recordSize != sizeof(JournalRecord)) {
+            std::cerr << "Journal " << path << " has an unknown format" << std::endl;
+            close();
+            return false;
+        }
+        baseSequence_ = header->baseSequence;
+
+        // Find the end: just past the last complete, valid record. Shards append concurrently,
+        // so a crash can leave a torn slot with valid records after it, and those may already be
+        // in the history store. Numbering resumes after the last of them, never inside the gap,
+        // so no sequence number is handed out twice; replay skips the torn slots.
+        std::uint64_t end = 0;
+        std::uint64_t torn = 0;
+        for (std::uint64_t index = 0; const JournalRecord* record = recordAt(index); ++index) {
+            if (record->length == 0) continue;
+            if (isValid(*record, baseSequence_ + index)) {
+                end = index + 1;
+            } else {
+                ++torn;
+            }
+        }
+        if (torn > 0) {
+            std::cerr << "Journal " << path << " has " << torn << " torn records from a crash; skipping them" << std::endl;
+        }
+        nextIndex_.store(end, std::memory_order_release);
+        return true;
+    }
+
+    // Resume numbering at sequence if the journal ends before it, leaving the slots in between
+    // empty. Used at startup so the journal never reuses a sequence number that a derived store
+    // has already committed, even if the journal lost those records in a crash.
+    // Only call while no appends are running.
+    void skipTo(std::uint64_t sequence) {
+        if (sequence <= nextSequence()) return;
+        std::uint64_t index = sequence - baseSequence_;
+        if (offsetOf(index) > allocated_.load(std::memory_order_acquire)) {
+            grow(offsetOf(index));
+        }
+        nextIndex_.store(index, std::memory_order_release);
+    }
+
+    // Flush written records to disk and release the mapping
+    void close() {
+        if (!base_) return;
+        sync();
+        munmap(base_, JOURNAL_MAX_BYTES);
+        ::close(fd_);
+        base_ = nullptr;
+        fd_ = -1;
+    }
+
+    // Force everything appended so far to stable storage
+    void sync() {
+        if (base_) {
+            msync(base_, offsetOf(nextIndex_.load(std::memory_order_acquire)), MS_SYNC);
+        }
+    }
+
+    // Append an event and return its sequence number; safe to call from any thread
+    std::uint64_t append(const PersistEvent& event) {
+        return writeRecord(nextIndex_.fetch_add(1, std::memory_order_relaxed), event);
+    }
+
+    // Journal the event, stamp it with its sequence number and pass it downstream
+    void publish(const PersistEvent& event) override {
+        PersistEvent stamped = event;
+        stamped.sequence = append(event);
+        if (downstream) {
+            downstream->publish(stamped);
+        }
+    }
+
+    // Hand every record with sequence >= fromSequence to fn, in order, skipping torn or
+    // empty slots. Only call while no appends are running (e.g. during startup recovery).
+    template <typename Fn>
+    void replay(std::uint64_t fromSequence, Fn&& fn) const {
+        std::uint64_t end = nextIndex_.load(std::memory_order_acquire);
+        std::uint64_t index = fromSequence > baseSequence_ ? fromSequence - baseSequence_ : 0;
+        for (; index < end; ++index) {
+            const JournalRecord& record = *recordAt(index);
+            if (!isValid(record, baseSequence_ + index)) continue;
+            PersistEvent event{};
+            event.sequence = record.sequence;
+            event.type = record.type;
+            event.side = record.side;
+            event.orderId = record.orderId;
+            event.matchedOrderId = record.matchedOrderId;
+            event.price = record.price;
+            event.quantity = record.quantity;
+            std::memcpy(event.ticker, record.ticker, TICKER_SIZE);
+            fn(event);
+        }
+    }
+
+    // Drop every record before keepFrom by copying the rest into a new journal that then
+    // replaces this one. Only call while no appends are running (e.g. at startup, after recovery).
+    bool compact(std::uint64_t keepFrom) {
+        keepFrom = std::min(std::max(keepFrom, baseSequence_), nextSequence());
+        if (keepFrom == baseSequence_) {
+            return true;
+        }
+        std::string path = path_;
+        std::string tempPath = path + ".compact";
+        std::remove(tempPath.c_str());
+        {
+            EventJournal compacted;
+            if (!compacted.open(tempPath, keepFrom)) {
+                return false;
+            }
+            // Records keep their sequence numbers: each goes to its own slot, gaps included
+            replay(keepFrom, [&compacted, keepFrom](const PersistEvent& event) {
+                compacted.writeRecord(event.sequence - keepFrom, event);
+            });
+            compacted.nextIndex_.store(nextSequence() - keepFrom, std::memory_order_release);
+            // Closing syncs the copy before it replaces the original
+        }
+        close();
+        bool installed = std::rename(tempPath.c_str(), path.c_str()) == 0;
+        if (!installed) {
+            std::cerr << "Failed to install compacted journal " << path << std::endl;
+        }
+        return open(path) && installed;
+    }
+
+    // Sequence number of the oldest record this journal can hold
+    [[nodiscard]] std::uint64_t firstSequence() const {
+        return baseSequence_;
+    }
+
+    // Sequence number the next appended record will receive
+    [[nodiscard]] std::uint64_t nextSequence() const {
+        return baseSequence_ + nextIndex_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Fill the record slot at index with event; the slot must not be written by anyone else
+    std::uint64_t writeRecord(std::uint64_t index, const PersistEvent& event) {
+        std::size_t end = offsetOf(index + 1);
+        if (end > allocated_.load(std::memory_order_acquire)) {
+            grow(end);
+        }
+
+        auto* record = reinterpret_cast<JournalRecord*>(base_ + offsetOf(index));
+        record->sequence = baseSequence_ + index;
+        record->type = event.type;
+        record->side = event.side;
+        record->orderId = event.orderId;
+        record->matchedOrderId = event.matchedOrderId;
+        record->price = event.price;
+        record->quantity = event.quantity;
+        std::memcpy(record->ticker, event.ticker, TICKER_SIZE);
+        record->checksum = checksumOf(*record);
+        std::atomic_thread_fence(std::memory_order_release);
+        record->length = sizeof(JournalRecord);
+        return record->sequence;
+    }
+
+    static std::size_t offsetOf(std::uint64_t index) {
+        return sizeof(JournalHeader) + index * sizeof(JournalRecord);
+    }
+
+    static std::uint32_t checksumOf(const JournalRecord& record) {
+        constexpr std::size_t skip = offsetof(JournalRecord, sequence);
+        return crc32c(reinterpret_cast<const char*>(&record) + skip, sizeof(JournalRecord) - skip);
+    }
+
+    bool isValid(const JournalRecord& record, std::uint64_t expectedSequence) const {
+        return record.length == sizeof(JournalRecord)
+            && record.sequence == expectedSequence
+            && record.checksum == checksumOf(record);
+    }
+
+    const JournalRecord* recordAt(std::uint64_t index) const {
+        if (offsetOf(index + 1) > allocated_.load(std::memory_order_acquire)) return nullptr;
+        return reinterpret_cast<const JournalRecord*>(base_ + offsetOf(index));
+    }
+
+    // Extend the file in whole chunks until it covers `needed` bytes (slow path)
+    void grow(std::size_t needed) {
+        std::lock_guard<std::mutex> lock(growMutex_);
+        std::size_t size = allocated_.load(std::memory_order_acquire);
+        if (size >= needed) return;
+        if (needed > JOURNAL_MAX_BYTES) {
+            std::cerr << "Journal is full" << std::endl;
+            std::abort();
+        }
+        while (size < needed) size += JOURNAL_CHUNK_BYTES;
+        size = std::min(size, JOURNAL_MAX_BYTES);
+#if defined(__linux__)
+        int rc = posix_fallocate(fd_, 0, static_cast<off_t>(size));
+#else
+        int rc = ftruncate(fd_, static_cast<off_t>(size));
+#endif
+        if (rc != 0) {
+            std::cerr << "Failed to extend journal: " << std::strerror(rc > 0 ? rc : errno) << std::endl;
+            std::abort();
+        }
+        allocated_.store(size, std::memory_order_release);
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    char* base_ = nullptr;
+    std::uint64_t baseSequence_ = 1;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> nextIndex_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> allocated_{0};
+    std::mutex growMutex_;
+};
+
+// Write every journaled event from fromSequence on into a derived store in one batch.
+// Used at startup to bring SQLite up to date with events it had not committed yet.
+// False if the batch could not be committed; the journal still holds every event.
+inline bool replayJournalInto(const EventJournal& journal, EventSink& sink, std::uint64_t fromSequence,
+                              std::size_t& replayed) {
+    replayed = 0;
+    if (journal.nextSequence() <= fromSequence) {
+        return true;
+    }
+    sink.beginBatch();
+    journal.replay(fromSequence, [&sink, &replayed](const PersistEvent& event) {
+        sink.writeEvent(event);
+        ++replayed;
+    });
+    return sink.commitBatch();
+}
+
+#endif // JOURNAL_H
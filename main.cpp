@@ -1,55 +1,62 @@
 #include <iostream>
 #include "orderbook.hpp"
+#include "ringbuffer.hpp"
+#include "command.hpp"
+#include "sequencer.hpp"
+#include "persistence.hpp"
+#include "journal.hpp"
+#include "snapshot.hpp"
+#include "storage.hpp"
+#include "sqlitestore.hpp"
+#include "historyquery.hpp"
+#include "reporting.hpp"
+#include "compaction.hpp"
+#include "tickercache.hpp"
+#include "symbolmaster.hpp"
+#include "httpclient.hpp"
+#include "priceservice.hpp"
+#include "priceband.hpp"
+#include "replay.hpp"
+#include "numparse.hpp"
+#include "pgstore.hpp"
+#include "benchmark.hpp"
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <algorithm>
 #include <limits>
 #include <thread>
 #include <mutex>
 #include <atomic>
-#include <condition_variable>
-#include <queue>
 #include <vector>
+#include <sstream>
 #include <chrono>
 #include <sqlite3.h>
 #include <curl/curl.h>
 #include "json.hpp"  // from https://github.com/nlohmann/json
 #include <ctime>
+#include <cstring>
+#include <cstdlib>
 using json = nlohmann::json;
 
 OrderBook orderBook;
-std::mutex orderBookMutex;
 
-std::atomic<int> orderIdCounter(1);
-
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
-    size_t totalSize = size * nmemb;
-    userp->append((char*)contents, totalSize);
-    return totalSize;
-}
-
-bool validateTicker(const std::string& ticker, const std::string& apiKey) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "Failed to init curl\n";
-        return false;
-    }
+// Polygon requests go through a pool of reused connections
+HttpClient polygonHttp;
 
+// Ask Polygon whether a ticker is active. Transport and parse failures are UNAVAILABLE,
+// so they are retried rather than cached as unknown symbols.
+TickerStatus lookupTicker(const std::string& ticker, const std::string& apiKey) {
     std::string readBuffer;
     // Build URL for exact ticker search with Polygon API
     std::string url = "https://api.polygon.io/v3/reference/tickers?ticker=" + ticker +
                       "&market=stocks&active=true&apiKey=" + apiKey;
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+    CURLcode res = polygonHttp.get(url, readBuffer);
 
     if (res != CURLE_OK) {
         std::cerr << "Curl request failed: " << curl_easy_strerror(res) << "\n";
-        return false;
+        return TickerStatus::UNAVAILABLE;
     }
 
     try {
@@ -61,66 +68,92 @@ bool validateTicker(const std::string& ticker, const std::string& apiKey) {
                 if (item.contains("ticker") && item["ticker"].get<std::string>() == ticker) {
                     // Optional: check if "active" is true to be sure
                     if (item.contains("active") && item["active"].get<bool>() == true) {
-                        return true;  // Valid active ticker found
+                        return TickerStatus::ACTIVE;  // Valid active ticker found
                     }
                 }
             }
+        } else {
+            // No results array: an error reply (bad key, rate limit), not an answer about the ticker
+            return TickerStatus::UNAVAILABLE;
         }
     } catch (const std::exception& e) {
         std::cerr << "JSON parsing error: " << e.what() << "\n";
+        return TickerStatus::UNAVAILABLE;
     }
 
-    return false;
+    return TickerStatus::INACTIVE;
 }
 
-bool getTickerClosingPrice(std::string &ticker, std::string &alphaVantageKey) {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "Failed to init curl\n";
-    }
-    std::string readBuffer2;
-    std::string closingPriceURL = "https://www.alphavantage.co/query?function=TIME_SERIES_INTRADAY&symbol="+ ticker + "&interval=5min&apikey=" + alphaVantageKey;
-
-    curl_easy_setopt(curl, CURLOPT_URL, closingPriceURL.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer2);
+// Build a symbol master file from Polygon's ticker list, following next_url from page to page.
+// baseUrl can point at a local stand-in serving the same JSON. Polygon does not publish
+// tick or lot sizes, so every symbol gets a 0.01 tick and a lot of 1; edit the file to change them.
+bool buildSymbolMaster(const std::string& path, const std::string& baseUrl, const std::string& apiKey) {
+    std::vector<SymbolInfo> symbols;
+    std::string url = baseUrl + "/v3/reference/tickers?market=stocks&active=true&limit=1000&apiKey=" + apiKey;
+    while (!url.empty()) {
+        std::string readBuffer;
+        CURLcode res = polygonHttp.get(url, readBuffer);
+        if (res != CURLE_OK) {
+            std::cerr << "Curl request failed: " << curl_easy_strerror(res) << "\n";
+            return false;
+        }
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
+        url.clear();
+        try {
+            auto responseJson = json::parse(readBuffer);
+            if (!responseJson.contains("results") || !responseJson["results"].is_array()) {
+                std::cerr << "Unexpected ticker list response: " << readBuffer.substr(0, 200) << "\n";
+                return false;
+            }
+            for (const auto& item : responseJson["results"]) {
+                if (!item.contains("ticker")) continue;
+                SymbolInfo symbol;
+                symbol.ticker = item["ticker"].get<std::string>();
+                symbol.active = !item.contains("active") || item["active"].get<bool>();
+                symbols.push_back(std::move(symbol));
+            }
+            if (responseJson.contains("next_url") && responseJson["next_url"].is_string()) {
+                url = responseJson["next_url"].get<std::string>() + "&apiKey=" + apiKey;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "JSON parsing error: " << e.what() << "\n";
+            return false;
+        }
+    }
 
-    if (res != CURLE_OK) {
-        std::cerr << "Curl request failed: " << curl_easy_strerror(res) << "\n";
+    if (!writeSymbolMaster(path, symbols)) {
         return false;
     }
+    std::cout << "Wrote " << symbols.size() << " symbols to " << path << ".\n";
+    return true;
+}
 
-    try {
-        auto responseJson = json::parse(readBuffer2);
-
-        if (responseJson.contains("Time Series (5min)")) {
-            auto timeSeries = responseJson["Time Series (5min)"];
-
-            auto mostRecentDate = timeSeries.begin();  // <-- timeSeries declared here
-            if (mostRecentDate != timeSeries.end()) {
-                std::string date = mostRecentDate.key();
-                std::string closingPrice = mostRecentDate.value()["4. close"];
-                std::cout << "Closing Price on " << date << ": " << closingPrice << std::endl;
-                return true;
-            }
-        } else {
-            std::cerr << "Error: 'Time Series (5min)' not found in response.\n";
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error parsing JSON response: " << e.what() << std::endl;
+// Show the latest reference price for ticker and keep it on the price watchlist.
+// This only reads the price cache; prices are fetched in the background.
+void printReferencePrice(PriceService& prices, const std::string& ticker) {
+    prices.watch(ticker);
+    ReferencePrice price;
+    if (prices.latest(ticker, price)) {
+        std::cout << "Closing Price on " << formatHistoryTime(price.barTime) << ": " << price.close << std::endl;
+    } else {
+        std::cout << "No reference price for '" << ticker << "' yet; it is being fetched in the background.\n";
     }
-    return false;
 }
 
 enum class EventType {
     ADDBID,
     ADDASK,
     REMOVEORDER,
+    MODIFYORDER,
     ORDERHISTORY,
     SHOWACTIVEORDERS,
+    STATEMENTSTATS,
+    HISTORYSTATS,
+    EXPORTHISTORY,
+    ARCHIVEHISTORY,
+    ARCHIVESTATS,
+    COMPACTHISTORY,
+    RELOADSYMBOLS,
     UNKNOWN,
     QUIT
 };
@@ -159,110 +192,481 @@ EventType parseInput(const std::string& input) {
     if (cmd == "add bid") return EventType::ADDBID;
     if (cmd == "add ask") return EventType::ADDASK;
     if (cmd == "remove order") return EventType::REMOVEORDER;
+    if (cmd == "modify order") return EventType::MODIFYORDER;
     if (cmd == "order history") return EventType::ORDERHISTORY;
     if (cmd == "show active orders") return EventType::SHOWACTIVEORDERS;
+    if (cmd == "statement stats") return EventType::STATEMENTSTATS;
+    if (cmd == "history stats") return EventType::HISTORYSTATS;
+    if (cmd == "export history") return EventType::EXPORTHISTORY;
+    if (cmd == "archive history") return EventType::ARCHIVEHISTORY;
+    if (cmd == "archive stats") return EventType::ARCHIVESTATS;
+    if (cmd == "compact history") return EventType::COMPACTHISTORY;
+    if (cmd == "reload symbols") return EventType::RELOADSYMBOLS;
     if (cmd == "quit") return EventType::QUIT;
     return EventType::UNKNOWN;
 }
 
-class ThreadPool {
-public:
-    explicit ThreadPool(size_t num_threads = std::thread::hardware_concurrency()) {
-        stop_ = false;
-        for (size_t i = 0; i < num_threads; ++i) {
-            threads_.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(queue_mutex_);
-                        cv_.wait(lock, [this] {
-                            return stop_ || !tasks_.empty();
-                        });
-
-                        if (stop_ && tasks_.empty()) {
-                            return;
-                        }
-
-                        task = std::move(tasks_.front());
-                        tasks_.pop();
-                    }
-
-                    try {
-                        task();
-                    } catch (const std::exception& e) {
-                        std::cerr << "Task threw exception: " << e.what() << std::endl;
-                    } catch (...) {
-                        std::cerr << "Task threw an unknown exception" << std::endl;
-                    }
-                }
-            });
+// Apply one command to the order book; runs on the shard thread that owns its symbol.
+// In AFTER_COMMIT mode the acknowledgement waits until the command's history is committed.
+// persistence is null when the storage backend needs no persistence stage.
+void executeCommand(const Command& command, PersistenceWriter* persistence) {
+    auto awaitDurability = [persistence] {
+        if (persistence && persistence->mode() == DurabilityMode::AFTER_COMMIT) {
+            persistence->waitUntilDurable();
         }
+    };
+
+    switch (command.type) {
+        case CommandType::ADD: {
+            Order order(command.orderId, command.price, command.quantity, command.side, command.ticker);
+            orderBook.addOrder(order);
+            awaitDurability();
+            if (command.side == Side::BUY) {
+                std::cout << "Bid added: Ticker = "<< command.ticker <<", Price = " << command.price << ", Quantity = " << command.quantity << "\n";
+            } else {
+                std::cout << "Ask added: Ticker = "<< command.ticker <<", Price = " << command.price << ", Quantity = " << command.quantity << "\n";
+            }
+            break;
+        }
+        case CommandType::CANCEL: {
+            bool removed = orderBook.removeOrderById(command.orderId);
+            awaitDurability();
+            if (removed) {
+                std::cout << "Order " << command.orderId << " removed successfully.\n";
+            } else {
+                std::cout << "Failed to remove order " << command.orderId << ".\n";
+            }
+            break;
+        }
+        case CommandType::MODIFY: {
+            bool modified = orderBook.modifyOrder(command.orderId, command.price, command.quantity);
+            awaitDurability();
+            if (modified) {
+                std::cout << "Order " << command.orderId << " modified: Price = " << command.price << ", Quantity = " << command.quantity << "\n";
+            } else {
+                std::cout << "Failed to modify order " << command.orderId << ".\n";
+            }
+            break;
+        }
+        case CommandType::QUERY:
+            orderBook.displayActiveTickers(command.ticker);
+            break;
+        case CommandType::BARRIER:
+            break;  // Handled by the sequencer before it reaches here
     }
+}
 
-    ~ThreadPool() {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            stop_ = true;  // Set stop flag
+// Open the order history backend named by --storage (sqlite, journal, postgres or null).
+// Returns null, having reported why, if it is unknown or cannot be opened.
+std::unique_ptr<StorageBackend> openStorage(const std::string& kind, const SqliteProfile& profile,
+                                            const std::string& pgConnection, std::size_t loadThreads,
+                                            const EventJournal& journal) {
+    if (kind == "sqlite") {
+        auto store = std::make_unique<SqliteStore>();
+        if (!store->open("orderhistory.db", profile)) {
+            return nullptr;
         }
-        cv_.notify_all();  // Notify all threads to wake up and stop
+        store->loadThreads = loadThreads;
+        reportSqliteProfile(store->DB, profile);
+        return store;
+    }
+    if (kind == "journal") {
+        return std::make_unique<JournalStore>(journal);
+    }
+    if (kind == "null") {
+        return std::make_unique<NullStore>();
+    }
+    if (kind == "postgres") {
+#ifdef ORDERBOOK_HAS_POSTGRES
+        auto store = std::make_unique<PostgresStore>();
+        if (!store->open(pgConnection)) {
+            return nullptr;
+        }
+        std::cout << "Order history: PostgreSQL (" << pgConnection << ").\n";
+        return store;
+#else
+        std::cerr << "This build has no PostgreSQL support (libpqxx not found).\n";
+        (void)pgConnection;
+        return nullptr;
+#endif
+    }
+    std::cerr << "Unknown storage '" << kind << "' (expected sqlite, journal, postgres or null).\n";
+    return nullptr;
+}
+
+// Read the value of a numeric command-line option. A value that is not a whole number
+// from min to max is reported and leaves value unchanged.
+template <typename Integer>
+bool parseOption(const char* option, const char* text, Integer min, Integer max, Integer& value) {
+    Integer parsed{};
+    if (!parseInteger(text, parsed) || parsed < min || parsed > max) {
+        std::cerr << "Invalid " << option << " value '" << text << "' (expected " << min << " to " << max << ").\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
 
-        for (auto& thread : threads_) {
-            if (thread.joinable()) {
-                thread.join();  // Wait for all threads to finish
+// The same for options that take a decimal number
+bool parseOption(const char* option, const char* text, double min, double max, double& value) {
+    Decimal parsed;
+    if (!parseDecimal(text, parsed) || toDouble(parsed) < min || toDouble(parsed) > max) {
+        std::cerr << "Invalid " << option << " value '" << text << "' (expected " << min << " to " << max << ").\n";
+        return false;
+    }
+    value = toDouble(parsed);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    WaitStrategy waitStrategy = WaitStrategy::BACKOFF;
+    std::size_t shardCount = 4;
+    DurabilityMode durabilityMode = DurabilityMode::AFTER_COMMIT;
+    GroupCommitPolicy commitPolicy;
+    std::string journalPath = "orderjournal.bin";
+    std::string snapshotPath = "orderbook.snapshot";
+    std::uint64_t snapshotEvery = 10000;
+    std::size_t loadThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::string storage = "sqlite";
+    std::string pgConnection = "dbname=orderbook";
+    std::string archiveDirectory = "archive";
+    CompactionPolicy compactionPolicy;
+    bool compactInBackground = false;
+    TickerCachePolicy tickerCachePolicy;
+    PriceServicePolicy pricePolicy;
+    std::string priceUrl = "https://www.alphavantage.co";
+    std::string watchlist;
+    double priceBandPercent = 10;
+    std::string replayPath;
+    std::string symbolsPath;
+    std::string buildSymbolsPath;
+    std::string polygonUrl = "https://api.polygon.io";
+
+    // The SQLite profile comes from ORDERBOOK_DB_PROFILE unless --db-profile overrides it
+    std::string profileName = std::getenv("ORDERBOOK_DB_PROFILE") ? std::getenv("ORDERBOOK_DB_PROFILE") : "";
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--db-profile") == 0) {
+            profileName = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--pg") == 0) {
+            pgConnection = argv[i + 1];
+        }
+    }
+    const SqliteProfile* dbProfile = profileName.empty() ? &defaultSqliteProfile() : findSqliteProfile(profileName);
+    if (!dbProfile) {
+        std::cerr << "Unknown SQLite profile '" << profileName << "' (expected strict, balanced or fast).\n";
+        return 1;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--busy-spin") == 0) {
+            waitStrategy = WaitStrategy::BUSY_SPIN;
+        } else if (std::strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            // More shards than cores only adds threads competing for them
+            std::size_t maxShards = std::min<std::size_t>(
+                std::max(1u, std::thread::hardware_concurrency()), Sequencer::MAX_SHARDS);
+            if (!parseInteger(argv[++i], shardCount) || shardCount == 0) {
+                std::cerr << "Invalid --shards value '" << argv[i] << "' (expected 1 to " << maxShards << ").\n";
+                return 1;
+            }
+            if (shardCount > maxShards) {
+                std::cerr << "Limiting --shards " << shardCount << " to " << maxShards << ", the number of cores.\n";
+                shardCount = maxShards;
+            }
+        } else if (std::strcmp(argv[i], "--durability") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "match") == 0) {
+                durabilityMode = DurabilityMode::AFTER_MATCH;
+            } else if (std::strcmp(argv[i], "commit") == 0) {
+                durabilityMode = DurabilityMode::AFTER_COMMIT;
+            } else {
+                std::cerr << "Unknown --durability '" << argv[i] << "' (expected commit or match).\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--commit-batch") == 0 && i + 1 < argc) {
+            if (!parseOption("--commit-batch", argv[++i], std::size_t{1}, PERSISTENCE_RING_CAPACITY,
+                             commitPolicy.maxBatchSize)) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--commit-window-us") == 0 && i + 1 < argc) {
+            std::int64_t microseconds = 0;
+            if (!parseOption("--commit-window-us", argv[++i], std::int64_t{0}, std::int64_t{1000000}, microseconds)) {
+                return 1;
+            }
+            commitPolicy.maxDelay = std::chrono::microseconds(microseconds);
+        } else if (std::strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journalPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--snapshot-every") == 0 && i + 1 < argc) {
+            if (!parseOption("--snapshot-every", argv[++i], std::uint64_t{0}, std::uint64_t{1000000000}, snapshotEvery)) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--load-threads") == 0 && i + 1 < argc) {
+            if (!parseOption("--load-threads", argv[++i], std::size_t{1}, std::size_t{256}, loadThreads)) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--archive-after") == 0 && i + 1 < argc) {
+            int days = 0;
+            if (!parseOption("--archive-after", argv[++i], 0, 36500, days)) {
+                return 1;
+            }
+            compactionPolicy.olderThan = std::chrono::hours(24 * days);
+            compactInBackground = true;
+        } else if (std::strcmp(argv[i], "--archive-dir") == 0 && i + 1 < argc) {
+            archiveDirectory = argv[++i];
+        } else if (std::strcmp(argv[i], "--archive-rate") == 0 && i + 1 < argc) {
+            if (!parseOption("--archive-rate", argv[++i], std::size_t{1}, std::size_t{10000000},
+                             compactionPolicy.rowsPerSecond)) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--archive-every") == 0 && i + 1 < argc) {
+            int seconds = 0;
+            if (!parseOption("--archive-every", argv[++i], 1, 31536000, seconds)) {
+                return 1;
+            }
+            compactionPolicy.interval = std::chrono::seconds(seconds);
+        } else if (std::strcmp(argv[i], "--ticker-ttl") == 0 && i + 1 < argc) {
+            int seconds = 0;
+            if (!parseOption("--ticker-ttl", argv[++i], 0, 31536000, seconds)) {
+                return 1;
             }
+            tickerCachePolicy.positiveTtl = std::chrono::seconds(seconds);
+        } else if (std::strcmp(argv[i], "--ticker-negative-ttl") == 0 && i + 1 < argc) {
+            int seconds = 0;
+            if (!parseOption("--ticker-negative-ttl", argv[++i], 0, 31536000, seconds)) {
+                return 1;
+            }
+            tickerCachePolicy.negativeTtl = std::chrono::seconds(seconds);
+        } else if (std::strcmp(argv[i], "--watchlist") == 0 && i + 1 < argc) {
+            watchlist = argv[++i];
+        } else if (std::strcmp(argv[i], "--price-refresh") == 0 && i + 1 < argc) {
+            int seconds = 0;
+            if (!parseOption("--price-refresh", argv[++i], 1, 86400, seconds)) {
+                return 1;
+            }
+            pricePolicy.refreshInterval = std::chrono::seconds(seconds);
+        } else if (std::strcmp(argv[i], "--price-band") == 0 && i + 1 < argc) {
+            if (!parseOption("--price-band", argv[++i], 0.0, 1000.0, priceBandPercent)) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--price-url") == 0 && i + 1 < argc) {
+            priceUrl = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--convert-orders") == 0 && i + 2 < argc) {
+            std::vector<Command> commands;
+            std::string error;
+            if (!loadReplayFile(argv[i + 1], commands, error)) {
+                std::cerr << "Error reading order file: " << error << std::endl;
+                return 1;
+            }
+            if (!writeReplayFile(argv[i + 2], commands)) {
+                return 1;
+            }
+            std::cout << "Wrote " << commands.size() << " records to " << argv[i + 2] << ".\n";
+            return 0;
+        } else if (std::strcmp(argv[i], "--symbols") == 0 && i + 1 < argc) {
+            symbolsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--polygon-url") == 0 && i + 1 < argc) {
+            polygonUrl = argv[++i];
+        } else if (std::strcmp(argv[i], "--build-symbols") == 0 && i + 1 < argc) {
+            buildSymbolsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--storage") == 0 && i + 1 < argc) {
+            storage = argv[++i];
+        } else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            std::string benchmark = argv[++i];
+            std::size_t count = (i + 1 < argc) ? std::strtoul(argv[i + 1], nullptr, 10) : 0;
+            if (benchmark == "group-commit") {
+                runGroupCommitBenchmark(count ? count : 20000, *dbProfile);
+            } else if (benchmark == "journal") {
+                runJournalBenchmark(count ? count : 10000000);
+            } else if (benchmark == "storage") {
+                runStorageBenchmark(count ? count : 200000, *dbProfile, pgConnection);
+            } else if (benchmark == "matching") {
+                runMatchingBenchmark(count ? count : 200000, *dbProfile);
+            } else if (benchmark == "archive") {
+                runArchiveBenchmark(count ? count : 2000000);
+            } else if (benchmark == "http") {
+                runHttpBenchmark(count ? count : 2000);
+            } else if (benchmark == "prices") {
+                runPriceServiceBenchmark(count ? count : 50);
+            } else if (benchmark == "intraday-parse") {
+                runIntradayParseBenchmark(count ? count : 4000);
+            } else if (benchmark == "number-parse") {
+                runNumberParseBenchmark(count ? count : 1000000);
+            } else if (benchmark == "ticker-cache") {
+                runTickerCacheBenchmark(count ? count : 10000000);
+            } else if (benchmark == "startup-load") {
+                runStartupLoadBenchmark(count ? count : 10000000);
+            } else {
+                std::cout << "Unknown benchmark '" << benchmark << "'.\n";
+            }
+            return 0;
         }
     }
 
-    void enqueue(std::function<void()> task) {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            tasks_.emplace(std::move(task));  // Add task to queue
+    const std::string polygonApiKey = "API_KEY_HERE";
+    if (!buildSymbolsPath.empty()) {
+        return buildSymbolMaster(buildSymbolsPath, polygonUrl, polygonApiKey) ? 0 : 1;
+    }
+
+    // Orders are validated against the local symbol master when one is given, with no network involved
+    SymbolMaster symbols;
+    if (!symbolsPath.empty()) {
+        if (!symbols.load(symbolsPath)) {
+            return 1;
         }
-        cv_.notify_one();  // Notify one thread to pick up the task
+        auto index = symbols.index();
+        std::cout << "Loaded " << index->size() << " symbols (" << index->activeCount() << " active) from "
+                  << symbolsPath << ".\n";
     }
 
-private:
-    std::vector<std::thread> threads_;
-    std::queue<std::function<void()>> tasks_;
-    std::mutex queue_mutex_;
-    std::condition_variable cv_;
-    bool stop_;
-};
+    // The journal is the primary record of order events and the storage backend is derived from
+    // it. The null backend records nothing, so it runs without a journal, persistence stage or snapshots.
+    EventJournal journal;
+    std::unique_ptr<StorageBackend> store = openStorage(storage, *dbProfile, pgConnection, loadThreads, journal);
+    if (!store) {
+        return 1;
+    }
+    bool journaled = storage != "null";
+    orderBook.store = store.get();
+
+    if (journaled) {
+        // A journal used as the backend is never behind itself; any other backend is caught up from it
+        std::uint64_t historySequence = storage == "journal" ? 0 : store->journalSequence();
+        if (!journal.open(journalPath, historySequence + 1)) {
+            return 1;
+        }
+        // Never hand out a sequence the backend already holds, even if the journal lost it
+        journal.skipTo(historySequence + 1);
+        if (storage != "journal") {
+            std::size_t replayed = 0;
+            if (!replayJournalInto(journal, *store, historySequence + 1, replayed)) {
+                std::cerr << "Could not bring order history up to date from the journal.\n";
+                return 1;
+            }
+            if (replayed > 0) {
+                std::cout << "Replayed " << replayed << " journal events into order history.\n";
+            }
+        }
+    }
 
-double parseDoubleWithCommas(const std::string& input) {
-    std::string cleaned;
-    cleaned.reserve(input.size());
+    // Rebuild the live book from the latest snapshot plus the journal tail, or from the backend without one
+    std::size_t tailEvents = 0;
+    std::uint64_t tailFrom = 0;
+    bool fromSnapshot = journaled && recoverFromSnapshot(orderBook, journal, snapshotPath, tailEvents, tailFrom);
+    if (fromSnapshot) {
+        std::cout << "Recovered book from " << snapshotPath << " and " << tailEvents << " journal events.\n";
+    } else {
+        store->loadLiveOrders(orderBook);
+    }
 
-    // Keep digits, '.', and '-'; skip commas
-    std::copy_if(input.begin(), input.end(), std::back_inserter(cleaned),
-                 [](char c) { return (std::isdigit(c) || c == '.' || c == '-'); });
+    // Journal records that the backend has stored and the snapshot covers are no longer needed.
+    // They are dropped here, before anything appends, once they fill a preallocation chunk.
+    // A journal that is itself the backend is never compacted.
+    if (journaled && storage != "journal") {
+        std::uint64_t keepFrom = store->journalSequence() + 1;
+        if (fromSnapshot) {
+            keepFrom = std::min(keepFrom, tailFrom);
+        }
+        std::uint64_t dropped = keepFrom > journal.firstSequence() ? keepFrom - journal.firstSequence() : 0;
+        if (dropped * sizeof(JournalRecord) >= JOURNAL_CHUNK_BYTES) {
+            if (!journal.compact(keepFrom)) {
+                return 1;
+            }
+            std::cout << "Compacted journal: dropped " << dropped << " records.\n";
+        }
+    }
 
-    try {
-        return std::stod(cleaned);
-    } catch (const std::exception& e) {
-        std::cerr << "Error parsing number '" << input << "': " << e.what() << std::endl;
-        return std::numeric_limits<double>::quiet_NaN();  // signal invalid
+    EventDispatcher dispatcher;
+
+    // Events are journaled on the matching thread, then written to the history store by a
+    // separate persistence stage, off the matching path. The journal backend needs no such stage.
+    std::unique_ptr<PersistenceWriter> persistence;
+    if (journaled && storage != "journal") {
+        persistence = std::make_unique<PersistenceWriter>(*store, durabilityMode, commitPolicy);
+        journal.downstream = persistence.get();
+    }
+    if (journaled) {
+        orderBook.publisher = &journal;
     }
-}
 
-int main() {
-    orderBook.initializeDB();
-    orderBook.loadsOrdersFromDB();
+    // Commands are sequenced at ingress and executed per symbol, in order, on shard threads
+    ReplayLatency replayLatency;
+    Sequencer sequencer(shardCount, orderBook.lastOrderId + 1,
+                        [&persistence, &replayLatency](Command& command) {
+                            executeCommand(command, persistence.get());
+                            replayLatency.executed(command.sequence);
+                        }, waitStrategy);
+    for (const auto& [orderId, location] : orderBook.orderIndex) {
+        sequencer.registerOrder(orderId, location.ticker);
+    }
 
-    ThreadPool threadPool(4);
-    EventDispatcher dispatcher;
+    // Snapshots are taken with every shard paused, after the journal they point into is synced
+    auto takeSnapshot = [&sequencer, &journal, &snapshotPath, journaled]() {
+        if (!journaled) return;
+        sequencer.runExclusive([&sequencer, &journal, &snapshotPath]() {
+            journal.sync();
+            // Orders filled on arrival never rest, so the book alone can miss the newest IDs
+            orderBook.lastOrderId = std::max(orderBook.lastOrderId, sequencer.nextOrderId() - 1);
+            writeSnapshot(orderBook, journal.nextSequence(), snapshotPath);
+        });
+    };
+    std::uint64_t snapshotSequence = sequencer.sequenced();
+
+    // Batch mode: stream an order file through the sequencer with no prompts, pauses or
+    // network checks, report throughput and latency, and exit. Per-order output is muted.
+    // With --symbols, adds are still checked against the local symbol master.
+    if (!replayPath.empty()) {
+        std::vector<Command> commands;
+        std::string error;
+        auto loadStart = std::chrono::steady_clock::now();
+        if (!loadReplayFile(replayPath, commands, error)) {
+            std::cerr << "Error reading order file: " << error << std::endl;
+            return 1;
+        }
+        double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+        std::cout.setstate(std::ios::failbit);
+        ReplayResult result = replayCommands(sequencer, commands, replayLatency, [&symbols](const Command& command) {
+            return !symbols.loaded()
+                || (symbols.status(command.ticker) == TickerStatus::ACTIVE
+                    && symbols.checkOrder(command.ticker, command.price, command.quantity).empty());
+        });
+        std::cout.clear();
+        printReplayResult(result, loadSeconds);
+        takeSnapshot();
+        return 0;
+    }
+
+    // Without a symbol master, tickers are validated with Polygon, which is asked only when no fresh answer is cached
+    TickerValidationCache tickerCache([&polygonApiKey](const std::string& ticker) {
+        return lookupTicker(ticker, polygonApiKey);
+    }, tickerCachePolicy);
+    auto tickerActive = [&symbols, &tickerCache](const std::string& ticker) {
+        return symbols.loaded() ? symbols.status(ticker) == TickerStatus::ACTIVE : tickerCache.validate(ticker);
+    };
+
+    // Reference prices for the watchlist, and for every ticker entered, are fetched and
+    // refreshed in the background; handlers only read the latest one
+    PriceService prices(priceUrl, "ENTER_YOUR_API_KEY_HERE", pricePolicy);
+    std::stringstream watchlistTickers(watchlist);
+    for (std::string ticker; std::getline(watchlistTickers, ticker, ',');) {
+        if (!ticker.empty() && !prices.watch(ticker)) {
+            std::cout << "Not watching '" << ticker << "' (too long, or the watchlist is full).\n";
+        }
+    }
+    prices.start();
+    PriceBand priceBand(prices, priceBandPercent);
 
     // Register ADDBID handler
-    dispatcher.registerHandler(EventType::ADDBID, [&threadPool](const Event&) {
+    dispatcher.registerHandler(EventType::ADDBID, [&sequencer, &symbols, &tickerActive, &prices, &priceBand](const Event&) {
     std::string ticker;
     std::cout << "Adding bid\nEnter ticker: ";
     std::getline(std::cin, ticker);
-        std::string apiKey = "API_KEY_HERE";
-        std::string alphaVantageKey = "ENTER_YOUR_API_KEY_HERE";
 
 
 
-    if (validateTicker(ticker, apiKey)) {
+    if (tickerActive(ticker)) {
         std::cout << "Ticker '" << ticker << "' is valid and active.\n";
     } else {
     std::cout << "Ticker '" << ticker << "' is invalid or inactive.\n";
@@ -273,13 +677,13 @@ int main() {
         return;
     }
 
-        getTickerClosingPrice(ticker, apiKey);
+        printReferencePrice(prices, ticker);
 
     std::string priceStr;
     std::cout << "Enter price: ";
     std::getline(std::cin, priceStr);
-    double price = parseDoubleWithCommas(priceStr);
-    if (std::isnan(price)) {
+    Decimal priceValue;
+    if (!parseDecimal(priceStr, priceValue)) {
         std::cout << "Invalid price. Try again.\n";
         return;
     }
@@ -287,31 +691,40 @@ int main() {
     std::string quantityStr;
     std::cout << "Enter quantity: ";
     std::getline(std::cin, quantityStr);
-    double quantity = parseDoubleWithCommas(quantityStr);
-    if (std::isnan(quantity)) {
+    Decimal quantityValue;
+    if (!parseDecimal(quantityStr, quantityValue)) {
         std::cout << "Invalid quantity. Try again.\n";
         return;
     }
 
-    threadPool.enqueue([price, quantity, ticker]() {
-        std::lock_guard<std::mutex> lock(orderBookMutex);
-        Order order(orderIdCounter.fetch_add(1), price, quantity, Side::BUY, ticker);
-        orderBook.addOrder(order);
-        std::cout << "Bid added: Ticker = "<< ticker <<", Price = " << price << ", Quantity = " << quantity << "\n";
-    });
+    double price = toDouble(priceValue);
+    double quantity = toDouble(quantityValue);
+    std::string rejection = symbols.checkOrder(ticker, priceValue, quantityValue);
+    if (rejection.empty()) {
+        rejection = priceBand.check(ticker, price);
+    }
+    if (!rejection.empty()) {
+        std::cout << rejection << " Try again.\n";
+        return;
+    }
+
+    Command command;
+    if (makeAddCommand(Side::BUY, price, quantity, ticker, command)) {
+        sequencer.submit(command);
+    } else {
+        std::cout << "Ticker '" << ticker << "' is too long.\n";
+    }
 });
 
 
     // Register ADDASK handler
-    dispatcher.registerHandler(EventType::ADDASK, [&threadPool](const Event&) {
+    dispatcher.registerHandler(EventType::ADDASK, [&sequencer, &symbols, &tickerActive, &prices, &priceBand](const Event&) {
         std::string ticker;
-        std::string apiKey = "API_KEY_HERE";
-        std::string alphaVantageKey = "ENTER_YOUR_API_KEY_HERE";
 
         std::cout << "Adding ask\nEnter ticker: ";
         std::getline(std::cin, ticker);
 
-        if (validateTicker(ticker, apiKey)) {
+        if (tickerActive(ticker)) {
         std::cout << "Ticker '" << ticker << "' is valid and active.\n";
     } else {
         std::cout << "Ticker '" << ticker << "' is invalid or inactive.\n";
@@ -323,13 +736,13 @@ int main() {
             std::cout << "Invalid ticker. Try again.\n";
             return;
         }
-        getTickerClosingPrice(ticker, apiKey);
+        printReferencePrice(prices, ticker);
 
         std::string priceStr;
         std::cout << "Enter price: ";
         std::getline(std::cin, priceStr);
-        double price = parseDoubleWithCommas(priceStr);
-        if (std::isnan(price)) {
+        Decimal priceValue;
+        if (!parseDecimal(priceStr, priceValue)) {
             std::cout << "Invalid price. Try again.\n";
             return;
         }
@@ -337,23 +750,34 @@ int main() {
     std::string quantityStr;
     std::cout << "Enter quantity: ";
     std::getline(std::cin, quantityStr);
-    double quantity = parseDoubleWithCommas(quantityStr);
-    if (std::isnan(quantity)) {
+    Decimal quantityValue;
+    if (!parseDecimal(quantityStr, quantityValue)) {
         std::cout << "Invalid quantity. Try again.\n";
         return;
     }
 
-    threadPool.enqueue([price, quantity, ticker]() {
-        std::lock_guard<std::mutex> lock(orderBookMutex);
-        Order order(orderIdCounter.fetch_add(1), price, quantity, Side::SELL, ticker);
-        orderBook.addOrder(order);
-        std::cout << "Ask added: Ticker = "<< ticker <<", Price = " << price << ", Quantity = " << quantity << "\n";
-    });
+    double price = toDouble(priceValue);
+    double quantity = toDouble(quantityValue);
+    std::string rejection = symbols.checkOrder(ticker, priceValue, quantityValue);
+    if (rejection.empty()) {
+        rejection = priceBand.check(ticker, price);
+    }
+    if (!rejection.empty()) {
+        std::cout << rejection << " Try again.\n";
+        return;
+    }
+
+    Command command;
+    if (makeAddCommand(Side::SELL, price, quantity, ticker, command)) {
+        sequencer.submit(command);
+    } else {
+        std::cout << "Ticker '" << ticker << "' is too long.\n";
+    }
 });
 
 
     // Register REMOVEORDER handler
-    dispatcher.registerHandler(EventType::REMOVEORDER, [&threadPool](const Event&) {
+    dispatcher.registerHandler(EventType::REMOVEORDER, [&sequencer](const Event&) {
         std::cout << "Enter order ID to remove: ";
         int orderId;
         std::cin >> orderId;
@@ -365,26 +789,202 @@ int main() {
         }
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
-        threadPool.enqueue([orderId]() {
-            std::lock_guard<std::mutex> lock(orderBookMutex);
-            bool removed = orderBook.removeOrderById(orderId);
-            if (removed) {
-                std::cout << "Order " << orderId << " removed successfully.\n";
-            } else {
-                std::cout << "Failed to remove order " << orderId << ".\n";
+        if (sequencer.submit(makeCancelCommand(orderId)) == 0) {
+            std::cout << "Failed to remove order " << orderId << ".\n";
+        }
+    });
+
+    // Register MODIFYORDER handler
+    dispatcher.registerHandler(EventType::MODIFYORDER, [&sequencer, &symbols, &priceBand](const Event&) {
+        std::cout << "Enter order ID to modify: ";
+        int orderId;
+        std::cin >> orderId;
+        if (std::cin.fail()) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            std::cout << "Invalid order ID. Try again.\n";
+            return;
+        }
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+        std::string priceStr;
+        std::cout << "Enter new price: ";
+        std::getline(std::cin, priceStr);
+        Decimal priceValue;
+        if (!parseDecimal(priceStr, priceValue)) {
+            std::cout << "Invalid price. Try again.\n";
+            return;
+        }
+
+        std::string quantityStr;
+        std::cout << "Enter new quantity: ";
+        std::getline(std::cin, quantityStr);
+        Decimal quantityValue;
+        if (!parseDecimal(quantityStr, quantityValue)) {
+            std::cout << "Invalid quantity. Try again.\n";
+            return;
+        }
+
+        double price = toDouble(priceValue);
+        double quantity = toDouble(quantityValue);
+        OrderLocation location;
+        if (orderBook.locateOrder(orderId, location)) {
+            std::string rejection = symbols.checkOrder(location.ticker, priceValue, quantityValue);
+            if (rejection.empty()) {
+                rejection = priceBand.check(location.ticker, price);
             }
-        });
+            if (!rejection.empty()) {
+                std::cout << rejection << " Try again.\n";
+                return;
+            }
+        }
+
+        if (sequencer.submit(makeModifyCommand(orderId, price, quantity)) == 0) {
+            std::cout << "Failed to modify order " << orderId << ".\n";
+        }
     });
 
+    // Reporting reads history on its own read-only connection, from WAL snapshots, so it
+    // never holds up matching or the writer. Only the SQLite backend can be browsed.
+    auto* sqliteStore = dynamic_cast<SqliteStore*>(store.get());
+    HistoryReader history;
+    if (sqliteStore) {
+        history.open(sqliteStore->dbPath);
+    }
+    auto historyAvailable = [&history, &store]() {
+        if (!history.handle()) {
+            std::cout << "Order history reports need --storage sqlite (current: " << store->name() << ").\n";
+        }
+        return history.handle() != nullptr;
+    };
+
     // Register ORDERHISTORY handler
-    dispatcher.registerHandler(EventType::ORDERHISTORY, [](const Event&) {
-        std::lock_guard<std::mutex> lock(orderBookMutex);
-        orderBook.displayOrders();  // Note: DB must be accessible here
+    dispatcher.registerHandler(EventType::ORDERHISTORY, [&history, &historyAvailable](const Event&) {
+        if (!historyAvailable()) return;
+        std::cout << "Filter (ticker=, side=buy|sell, from-id=, to-id=, since=, until=, page=; blank for all): ";
+        std::string filter;
+        std::getline(std::cin, filter);
+        HistoryQuery query;
+        if (!parseHistoryQuery(filter, query)) {
+            return;
+        }
+
+        // Each page is read in its own snapshot, released before waiting on the prompt so an
+        // idle pager never holds back WAL checkpoints. Keyset paging by order ID keeps pages
+        // from overlapping or skipping rows even though the writer commits in between.
+        int afterOrderId = 0;
+        while (true) {
+            HistoryPage page;
+            {
+                ReadSnapshot snapshot(history.handle());
+                page = history.page(query, afterOrderId);
+            }
+            if (page.rows.empty() && afterOrderId == 0) {
+                std::cout << "No matching orders.\n";
+                return;
+            }
+            printHistoryPage(page);
+            if (!page.hasMore) {
+                return;
+            }
+            std::cout << "Press Enter for the next page, or q to stop: ";
+            std::string answer;
+            std::getline(std::cin, answer);
+            if (answer == "q") {
+                return;
+            }
+            afterOrderId = page.lastOrderId;
+        }
+    });
+
+    dispatcher.registerHandler(EventType::STATEMENTSTATS, [sqliteStore, &store](const Event&) {
+        if (sqliteStore) {
+            sqliteStore->displayStatementStats();
+        } else {
+            std::cout << "Statement stats are only kept by the sqlite backend (current: " << store->name() << ").\n";
+        }
+    });
+
+    dispatcher.registerHandler(EventType::HISTORYSTATS, [&history, &historyAvailable](const Event&) {
+        if (!historyAvailable()) return;
+        printHistorySummary(history);
+    });
+
+    dispatcher.registerHandler(EventType::EXPORTHISTORY, [&history, &historyAvailable](const Event&) {
+        if (!historyAvailable()) return;
+        std::cout << "Enter file prefix (default orderhistory): ";
+        std::string prefix;
+        std::getline(std::cin, prefix);
+        exportHistory(history, prefix.empty() ? "orderhistory" : prefix);
     });
 
-    dispatcher.registerHandler(EventType::SHOWACTIVEORDERS, [](const Event&) {
-        std::lock_guard<std::mutex> lock(orderBookMutex);
-        std::string apiKey = "API_KEY_HERE";
+    dispatcher.registerHandler(EventType::ARCHIVEHISTORY, [&history, &historyAvailable](const Event&) {
+        if (!historyAvailable()) return;
+        std::cout << "Enter archive file (default orderhistory.obarc): ";
+        std::string path;
+        std::getline(std::cin, path);
+        archiveHistory(history, path.empty() ? "orderhistory.obarc" : path);
+    });
+
+    // Archives are read directly, so they can be analysed whichever storage backend is in use
+    dispatcher.registerHandler(EventType::ARCHIVESTATS, [](const Event&) {
+        std::cout << "Enter archive file (default orderhistory.obarc): ";
+        std::string path;
+        std::getline(std::cin, path);
+        std::cout << "Filter (ticker=, side=buy|sell, from-id=, to-id=, since=, until=; blank for all): ";
+        std::string filter;
+        std::getline(std::cin, filter);
+        HistoryQuery query;
+        ArchiveReader archive;
+        if (!parseHistoryQuery(filter, query) || !archive.open(path.empty() ? "orderhistory.obarc" : path)) {
+            return;
+        }
+        printArchiveSummary(archive, query);
+    });
+
+    // Old filled orders are moved from SQLite into archive files: in the background with
+    // --archive-after DAYS, or now with "compact history"
+    std::unique_ptr<HistoryCompactor> compactor;
+    if (sqliteStore) {
+        compactor = std::make_unique<HistoryCompactor>(*sqliteStore, archiveDirectory, compactionPolicy);
+        if (compactInBackground) {
+            compactor->start();
+        }
+    }
+
+    dispatcher.registerHandler(EventType::COMPACTHISTORY, [&compactor, &store](const Event&) {
+        if (!compactor) {
+            std::cout << "Compaction needs --storage sqlite (current: " << store->name() << ").\n";
+            return;
+        }
+        // With a background job, hand the run to it; otherwise run a short one here
+        if (compactor->wake()) {
+            std::cout << "Compaction started in the background; it reports when done.\n";
+            return;
+        }
+        CompactionResult result = compactor->runBriefly();
+        if (result.archived == 0 && result.pagesFreed == 0) {
+            std::cout << "Nothing to compact.\n";
+        }
+        HistoryCompactor::report(result);
+    });
+
+    // Re-read the symbol master; orders being validated keep the index they started with
+    dispatcher.registerHandler(EventType::RELOADSYMBOLS, [&symbols](const Event&) {
+        if (symbols.path().empty()) {
+            std::cout << "No symbol master in use (start with --symbols FILE).\n";
+            return;
+        }
+        if (symbols.reload()) {
+            auto index = symbols.index();
+            std::cout << "Reloaded " << index->size() << " symbols (" << index->activeCount() << " active) from "
+                      << symbols.path() << ".\n";
+        } else {
+            std::cout << "Keeping the previous symbol list.\n";
+        }
+    });
+
+    dispatcher.registerHandler(EventType::SHOWACTIVEORDERS, [&sequencer, &tickerActive](const Event&) {
         std::string ticker;
         std::cout << "Enter ticker: ";
         std::getline(std::cin, ticker);
@@ -396,33 +996,42 @@ int main() {
             return;
         }
 
-        if (validateTicker(ticker, apiKey)) {
+        if (tickerActive(ticker)) {
        std::cout << "Ticker '" << ticker << "' is valid and active.\n";
    } else {
        std::cout << "Ticker '" << ticker << "' is invalid or inactive.\n";
        return;
    }
 
-        orderBook.displayActiveTickers(ticker);
+        Command command;
+        if (makeQueryCommand(ticker, command)) {
+            sequencer.submit(command);
+        }
     });
 
 
 
     // Main event loop
     while (true) {
-        std::cout << "Enter command (add bid, add ask, remove order, order history, show active orders, quit): ";
+        std::cout << "Enter command (add bid, add ask, remove order, modify order, order history, history stats, export history, archive history, archive stats, compact history, reload symbols, show active orders, statement stats, quit): ";
         std::string input;
         std::getline(std::cin, input);
         EventType eventType = parseInput(input);
 
         if (eventType == EventType::QUIT) {
             std::cout << "Exiting program...\n";
+            takeSnapshot();
             break;
         }
 
         Event event(eventType);
         dispatcher.dispatch(event);
 
+        if (snapshotEvery > 0 && sequencer.sequenced() - snapshotSequence >= snapshotEvery) {
+            takeSnapshot();
+            snapshotSequence = sequencer.sequenced();
+        }
+
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
     }
 
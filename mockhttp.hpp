@@ -0,0 +1,137 @@
+#ifndef MOCKHTTP_H
+#define MOCKHTTP_H
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Minimal HTTP/1.1 server on the loopback interface, standing in for Polygon and
+// AlphaVantage in the benchmarks. Every GET is answered 200 with the handler's JSON,
+// on a keep-alive connection served by its own thread until the client hangs up or stop() is called.
+// handshakeDelay is added once per new connection, to model the TCP and TLS round trips
+// a real endpoint costs, and responseDelay to every request.
+class MockHttpServer {
+public:
+    using Handler = std::function<std::string(const std::string& target)>;
+
+    explicit MockHttpServer(Handler handler,
+                            std::chrono::microseconds handshakeDelay = {},
+                            std::chrono::microseconds responseDelay = {})
+        : handler_(std::move(handler)), handshakeDelay_(handshakeDelay), responseDelay_(responseDelay) {}
+
+    ~MockHttpServer() {
+        stop();
+    }
+
+    MockHttpServer(const MockHttpServer&) = delete;
+    MockHttpServer& operator=(const MockHttpServer&) = delete;
+
+    // Listen on an ephemeral loopback port
+    bool start() {
+        listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd_ < 0) return false;
+        int reuse = 1;
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (::bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || ::listen(listenFd_, 64) != 0
+            || ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            ::close(listenFd_);
+            listenFd_ = -1;
+            return false;
+        }
+        port_ = ntohs(address.sin_port);
+        acceptThread_ = std::thread([this] { acceptLoop(); });
+        return true;
+    }
+
+    void stop() {
+        if (listenFd_ < 0) return;
+        stopping_ = true;
+        ::shutdown(listenFd_, SHUT_RDWR);
+        acceptThread_.join();
+        ::close(listenFd_);
+        listenFd_ = -1;
+        // Connection sockets are closed only here, once their threads are done with them,
+        // so a descriptor is never reused while a thread still holds it
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        for (int fd : clientFds_) ::shutdown(fd, SHUT_RDWR);
+        for (std::thread& connection : connectionThreads_) connection.join();
+        for (int fd : clientFds_) ::close(fd);
+        clientFds_.clear();
+        connectionThreads_.clear();
+    }
+
+    [[nodiscard]] std::string baseUrl() const { return "http://127.0.0.1:" + std::to_string(port_); }
+    [[nodiscard]] std::size_t connections() const { return accepted_.load(); }
+    [[nodiscard]] std::size_t requests() const { return served_.load(); }
+
+private:
+    void acceptLoop() {
+        while (!stopping_) {
+            int fd = ::accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) {
+                if (stopping_) return;
+                continue;
+            }
+            ++accepted_;
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            clientFds_.push_back(fd);
+            connectionThreads_.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        if (handshakeDelay_.count() > 0) std::this_thread::sleep_for(handshakeDelay_);
+        std::string buffer;
+        char chunk[4096];
+        while (true) {
+            std::size_t end;
+            while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) return;
+                buffer.append(chunk, static_cast<std::size_t>(n));
+            }
+            std::string request = buffer.substr(0, end);
+            buffer.erase(0, end + 4);
+
+            // Request line: GET <target> HTTP/1.1
+            std::size_t targetStart = request.find(' ') + 1;
+            std::string target = request.substr(targetStart, request.find(' ', targetStart) - targetStart);
+            if (responseDelay_.count() > 0) std::this_thread::sleep_for(responseDelay_);
+            std::string body = handler_(target);
+            std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: "
+                + std::to_string(body.size()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+            ++served_;
+            if (::send(fd, response.data(), response.size(), MSG_NOSIGNAL) < 0) return;
+        }
+    }
+
+    Handler handler_;
+    std::chrono::microseconds handshakeDelay_;
+    std::chrono::microseconds responseDelay_;
+    int listenFd_ = -1;
+    std::uint16_t port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<std::size_t> accepted_{0};
+    std::atomic<std::size_t> served_{0};
+    std::thread acceptThread_;
+    std::mutex connectionsMutex_;
+    std::vector<int> clientFds_;
+    std::vector<std::thread> connectionThreads_;
+};
+
+#endif // MOCKHTTP_H
@@ -0,0 +1,138 @@
+#ifndef NUMPARSE_H
+#define NUMPARSE_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Prices and quantities arriving at ingress (the prompt, order files, and later sockets)
+// are parsed here instead of with std::stod: no copy of the text, no allocation, no
+// exceptions and no locale, in one pass over the characters. The result is an exact
+// decimal, so it can be turned into whole ticks and lots without binary rounding.
+
+// The number mantissa * 10^-scale
+struct Decimal {
+    std::int64_t mantissa = 0;
+    int scale = 0;
+};
+
+// Most digits a Decimal holds; 10^18 - 1 still fits in an int64
+constexpr int DECIMAL_MAX_DIGITS = 18;
+
+inline std::int64_t decimalPowerOfTen(int exponent) {
+    static constexpr std::int64_t powers[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+        10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000,
+        1000000000000000, 10000000000000000, 100000000000000000, 1000000000000000000};
+    return powers[exponent];
+}
+
+// Parse text such as "1234.5", "1,234.50", "-0.25" or ".5". Spaces around the number are
+// allowed, and thousands separators must split the whole part into groups of three.
+// Anything else (other characters, exponents, more than 18 digits) fails.
+inline bool parseDecimal(std::string_view text, Decimal& value) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    while (first != last && (*first == ' ' || *first == '\t')) ++first;
+    while (last != first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r' || last[-1] == '\n')) --last;
+    bool negative = first != last && *first == '-';
+    if (first != last && (*first == '-' || *first == '+')) ++first;
+
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    // Whole part: one run of digits, or a run of one to three followed by runs of exactly
+    // three, each ended by a separator except the last
+    for (int run = 0;; ++run) {
+        std::uint64_t group = 0;
+        auto [end, error] = std::from_chars(first, last, group);
+        if (error == std::errc::result_out_of_range) return false;
+        int length = static_cast<int>(end - first);
+        bool separator = end != last && *end == ',';
+        if (run > 0 ? length != 3 : separator && (length == 0 || length > 3)) return false;
+        if (digits + length > DECIMAL_MAX_DIGITS) return false;
+        mantissa = mantissa * static_cast<std::uint64_t>(decimalPowerOfTen(length)) + group;
+        digits += length;
+        first = separator ? end + 1 : end;
+        if (!separator) break;
+    }
+
+    int scale = 0;
+    if (first != last && *first == '.') {
+        ++first;
+        std::uint64_t fraction = 0;
+        auto [end, error] = std::from_chars(first, last, fraction);
+        if (error == std::errc::result_out_of_range) return false;
+        scale = static_cast<int>(end - first);
+        if (digits + scale > DECIMAL_MAX_DIGITS) return false;
+        mantissa = mantissa * static_cast<std::uint64_t>(decimalPowerOfTen(scale)) + fraction;
+        digits += scale;
+        first = end;
+    }
+    if (first != last || digits == 0) return false;
+
+    value.mantissa = negative ? -static_cast<std::int64_t>(mantissa) : static_cast<std::int64_t>(mantissa);
+    value.scale = scale;
+    return true;
+}
+
+// Plain decimal text that parseDecimal reads back exactly, such as "0.00001" or "12.50".
+// The scale is kept, so trailing zeros survive, and there is never an exponent.
+inline std::string formatDecimal(const Decimal& value) {
+    std::uint64_t magnitude = value.mantissa < 0 ? 0 - static_cast<std::uint64_t>(value.mantissa)
+                                                 : static_cast<std::uint64_t>(value.mantissa);
+    char digits[24];
+    std::string text(digits, std::to_chars(digits, digits + sizeof(digits), magnitude).ptr);
+    auto scale = static_cast<std::size_t>(std::max(value.scale, 0));
+    if (scale > 0) {
+        if (text.size() <= scale) text.insert(0, scale + 1 - text.size(), '0');
+        text.insert(text.size() - scale, 1, '.');
+    }
+    if (value.mantissa < 0) text.insert(0, 1, '-');
+    return text;
+}
+
+// The nearest double; exact for anything an order book sees, as both parts convert exactly
+inline double toDouble(const Decimal& value) {
+    return static_cast<double>(value.mantissa) / static_cast<double>(decimalPowerOfTen(value.scale));
+}
+
+// How many whole increments value is, for example the ticks in a price or the lots in a
+// quantity. False if value is not an exact multiple of increment.
+inline bool toIncrements(const Decimal& value, const Decimal& increment, std::int64_t& count) {
+    if (increment.mantissa <= 0) return false;
+    auto rescale = [](std::int64_t& number, int by) {
+        std::int64_t power = decimalPowerOfTen(by);
+        if (number > std::numeric_limits<std::int64_t>::max() / power
+            || number < std::numeric_limits<std::int64_t>::min() / power) {
+            return false;
+        }
+        number *= power;
+        return true;
+    };
+    std::int64_t numerator = value.mantissa;
+    std::int64_t denominator = increment.mantissa;
+    if (!(value.scale < increment.scale ? rescale(numerator, increment.scale - value.scale)
+                                        : rescale(denominator, value.scale - increment.scale))) {
+        return false;
+    }
+    if (numerator % denominator != 0) return false;
+    count = numerator / denominator;
+    return true;
+}
+
+// Parse an integer such as an order ID, with the same rules for spaces and no separators
+template <typename Integer>
+bool parseInteger(std::string_view text, Integer& value) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    while (first != last && (*first == ' ' || *first == '\t')) ++first;
+    while (last != first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r' || last[-1] == '\n')) --last;
+    auto [end, error] = std::from_chars(first, last, value);
+    return error == std::errc{} && end == last;
+}
+
+#endif // NUMPARSE_H
@@ -7,9 +7,14 @@
 #include <iostream>
 #include <algorithm>
 #include <chrono>
-#include <sqlite3.h>
 #include <iomanip>
 #include <string>
+#include <mutex>
+#include <shared_mutex>
+#include <queue>
+#include <vector>
+#include <cstring>
+#include <cstdint>
 
 // Enumeration to represent order side (buy or sell)
 enum class Side {
@@ -17,6 +22,9 @@ enum class Side {
     SELL
 };
 
+// Maximum ticker length (including the terminating null) in fixed-size records
+constexpr std::size_t TICKER_SIZE = 16;
+
 // Class representing a single order
 class Order {
 private:
@@ -148,6 +156,100 @@ public:
     void addOrder(const Order & order);
 };
 
+// Kind of change the matcher reports to the persistence stage
+enum class PersistEventType : std::uint8_t {
+    ORDER,   // New order accepted
+    FILL,    // Trade between an incoming and a resting order
+    CANCEL,  // Resting order removed
+    MODIFY   // Resting order changed price and/or quantity
+};
+
+// Fixed-size record describing one change to be written to order history
+struct PersistEvent {
+    std::uint64_t sequence;  // Journal sequence number; 0 when not journaled
+    PersistEventType type;
+    Side side;           // Side of the order (for FILL: the incoming order)
+    int orderId;         // The order (for FILL: the incoming order)
+    int matchedOrderId;  // FILL only: the resting order that was hit
+    double price;
+    double quantity;
+    char ticker[TICKER_SIZE];
+
+    static PersistEvent make(PersistEventType type, const Order& order) {
+        PersistEvent event{};
+        event.type = type;
+        event.side = order.getSide();
+        event.orderId = order.getOrderId();
+        event.price = order.getPrice();
+        event.quantity = order.getQuantity();
+        std::strncpy(event.ticker, order.getTicker().c_str(), TICKER_SIZE - 1);
+        return event;
+    }
+};
+
+// Receives persistence events, grouped into batches that are committed together
+class EventSink {
+public:
+    virtual ~EventSink() = default;
+    virtual void beginBatch() = 0;
+    virtual void writeEvent(const PersistEvent& event) = 0;
+    // Commit the batch; false if it could not be stored, in which case none of it was
+    virtual bool commitBatch() = 0;
+
+    // Write a single event as its own batch, for callers without a persistence stage
+    virtual void writeInline(const PersistEvent& event) {
+        beginBatch();
+        writeEvent(event);
+        commitBatch();
+    }
+};
+
+// Highest journal sequence below which every event has reached a sink. Journal events can
+// arrive slightly out of order (shards append concurrently), so a sequence only counts once
+// every sequence before it has been seen too.
+class JournalWatermark {
+public:
+    void reset(std::uint64_t sequence) {
+        highWater_ = committed_ = sequence;
+        pending_ = {};
+    }
+
+    void note(std::uint64_t sequence) {
+        if (sequence == 0 || sequence <= highWater_) return;
+        pending_.push(sequence);
+        while (!pending_.empty() && pending_.top() == highWater_ + 1) {
+            ++highWater_;
+            pending_.pop();
+        }
+    }
+
+    [[nodiscard]] std::uint64_t highWater() const { return highWater_; }
+
+    // True if the watermark moved since it was last stored
+    [[nodiscard]] bool advanced() const { return highWater_ != committed_; }
+
+    void markCommitted() { committed_ = highWater_; }
+
+private:
+    std::uint64_t highWater_ = 0;
+    std::uint64_t committed_ = 0;
+    std::priority_queue<std::uint64_t, std::vector<std::uint64_t>, std::greater<>> pending_;
+};
+
+// Accepts events from the matcher and hands them to an EventSink off the matching path
+class EventPublisher {
+public:
+    virtual ~EventPublisher() = default;
+    virtual void publish(const PersistEvent& event) = 0;
+};
+
+// Where a resting order lives in the book, so it can be found by ID
+struct OrderLocation {
+    std::string ticker;
+    Side side;
+    double price;
+};
+
 // Top-level order book that supports order matching and maintains order history
 class OrderBook {
 
@@ -155,49 +257,88 @@ public:
 
     std::unordered_map<std::string, OrderBookSellSide> sellSides;
     std::unordered_map<std::string, OrderBookBuySide> buySides;
+    std::unordered_map<int, OrderLocation> orderIndex;  // Resting orders by ID
+    int lastOrderId = 0;                                 // Highest order ID seen in history
+
+    EventPublisher* publisher = nullptr;  // Persistence stage; events go straight to store when unset
+    EventSink* store = nullptr;           // Order history store; nothing is recorded when unset
 
-    sqlite3 *DB;
+    // Each symbol is matched by exactly one shard thread, so the per-symbol sides need
+    // no locking; only the maps that hold them and the shared order index do.
+    mutable std::shared_mutex symbolsMutex;
+    mutable std::mutex indexMutex;
 
-    void initializeDB() {
-        int exit = sqlite3_open("orderhistory.db", &DB);
+    OrderBook() = default;
 
-        // Create the table only if it doesn't already exist
-        std::string sql = "CREATE TABLE IF NOT EXISTS ORDERS("
-                          "ORDER_ID INT PRIMARY KEY NOT NULL,"
-                          "TICKER TEXT NOT NULL,"
-                          "PRICE REAL NOT NULL,"
-                          "QUANTITY REAL NOT NULL,"
-                          "SIDE INT NOT NULL);";
+    // Record history in store; a persistence stage can be placed in front of it later
+    explicit OrderBook(EventSink* historyStore) : store(historyStore) {}
 
-        char* messageError;
-        exit = sqlite3_exec(DB, sql.c_str(), NULL, 0, &messageError);
-        if (exit != SQLITE_OK) {
-            std::cerr << "Error creating table: " << messageError << std::endl;
-            sqlite3_free(messageError);
+    // Report a change to order history, either to the persistence stage or straight to the store
+    void publish(const PersistEvent& event) {
+        if (publisher) {
+            publisher->publish(event);
+        } else if (store) {
+            store->writeInline(event);
         }
     }
 
+    // Sell side for a ticker, created on first use
+    OrderBookSellSide& asksFor(const std::string& ticker) {
+        {
+            std::shared_lock<std::shared_mutex> lock(symbolsMutex);
+            auto it = sellSides.find(ticker);
+            if (it != sellSides.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(symbolsMutex);
+        return sellSides[ticker];
+    }
+
+    // Buy side for a ticker, created on first use
+    OrderBookBuySide& bidsFor(const std::string& ticker) {
+        {
+            std::shared_lock<std::shared_mutex> lock(symbolsMutex);
+            auto it = buySides.find(ticker);
+            if (it != buySides.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(symbolsMutex);
+        return buySides[ticker];
+    }
+
+    void indexOrder(int orderId, const OrderLocation& location) {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        orderIndex[orderId] = location;
+    }
+
+    void unindexOrder(int orderId) {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        orderIndex.erase(orderId);
+    }
+
+    // Copy out the location of a resting order; false if it is not in the book
+    bool locateOrder(int orderId, OrderLocation& location) const {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        auto it = orderIndex.find(orderId);
+        if (it == orderIndex.end()) return false;
+        location = it->second;
+        return true;
+    }
+
 
 
     // Add a new order and attempt to match it
     void addOrder(Order &order) {
 
-        std::string ticker = order.getTicker();
-        OrderBookSellSide& asks = sellSides[ticker];
-        OrderBookBuySide& bids = buySides[ticker];
-
         // Store the order in history regardless of matching outcome
-        std::string sql("INSERT INTO ORDERS (ORDER_ID, TICKER, PRICE, QUANTITY, SIDE) VALUES (?, ?, ?, ?, ?);");
-        sqlite3_stmt *statement;
-        sqlite3_prepare_v2(DB, sql.c_str(), -1, &statement, nullptr);
-
-        sqlite3_bind_int(statement, 1, order.getOrderId());
-        sqlite3_bind_text(statement, 2, order.getTicker().c_str(), -1, nullptr);
-        sqlite3_bind_double(statement, 3, order.getPrice());
-        sqlite3_bind_double(statement, 4, order.getQuantity());
-        sqlite3_bind_int(statement, 5, static_cast<int>(order.getSide()));
-        sqlite3_step(statement);
-        sqlite3_finalize(statement);
+        publish(PersistEvent::make(PersistEventType::ORDER, order));
+
+        matchOrder(order);
+    }
+
+    // Match an order against the opposite side and rest any unfilled quantity
+    void matchOrder(Order &order) {
+        std::string ticker = order.getTicker();
+        OrderBookSellSide& asks = asksFor(ticker);
+        OrderBookBuySide& bids = bidsFor(ticker);
 
       if (order.getSide() == Side::BUY) {
             // Match BUY order against SELL orders
@@ -215,12 +356,14 @@ public:
 
                     // Apply the trade
                     std::cout << "Trade executed: " << tradeQuantity << " @ " << priceLevel.price << " (BUY matched with SELL)\n";
+                    publishFill(order, askOrder.getOrderId(), priceLevel.price, tradeQuantity);
                     order.reduceQuantity(tradeQuantity);
                     askOrder.reduceQuantity(tradeQuantity);
                     priceLevel.totalQuantity -= tradeQuantity;
 
                     // Remove fully filled order
                     if (askOrder.getQuantity() == 0) {
+                        unindexOrder(askOrder.getOrderId());
                         priceLevel.orders.pop_front();
                     }
                 }
@@ -236,6 +379,7 @@ public:
             // If unfilled quantity remains, add to BUY side book
             if (order.getQuantity() > 0) {
                 bids.addOrder(order);
+                indexOrder(order.getOrderId(), {ticker, Side::BUY, order.getPrice()});
             }
         } else {
             // Match SELL order against BUY orders
@@ -253,12 +397,14 @@ public:
 
                     // Apply the trade
                     std::cout << "\n Trade executed: " << tradeQuantity << " @ " << priceLevel.price << " (SELL matched with BUY)" << std::endl;
+                    publishFill(order, bidOrder.getOrderId(), priceLevel.price, tradeQuantity);
                     order.reduceQuantity(tradeQuantity);
                     bidOrder.reduceQuantity(tradeQuantity);
                     priceLevel.totalQuantity -= tradeQuantity;
 
                     // Remove fully filled order
                     if (bidOrder.getQuantity() == 0) {
+                        unindexOrder(bidOrder.getOrderId());
                         priceLevel.orders.pop_front();
                     }
                 }
@@ -274,117 +420,140 @@ public:
             // If unfilled quantity remains, add to SELL side book
             if (order.getQuantity() > 0) {
                 asks.addAsk(order);
+                indexOrder(order.getOrderId(), {ticker, Side::SELL, order.getPrice()});
             }
         }
     }
 
-    void loadsOrdersFromDB() {
-        std::string sql = "SELECT * FROM ORDERS";
-        sqlite3_stmt* statement;
-
-        int rc = sqlite3_prepare_v2(DB, sql.c_str(), -1, &statement, nullptr);
-        if (rc != SQLITE_OK) {
-            std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(DB) << std::endl;
-            return;
+    // Place an order at the back of its price level without matching it
+    void restOrder(Order& order) {
+        if (order.getSide() == Side::BUY) {
+            bidsFor(order.getTicker()).addOrder(order);
+        } else {
+            asksFor(order.getTicker()).addAsk(order);
         }
+        indexOrder(order.getOrderId(), {order.getTicker(), order.getSide(), order.getPrice()});
+        lastOrderId = std::max(lastOrderId, order.getOrderId());
+    }
 
-        while (sqlite3_step(statement) == SQLITE_ROW) {
-            int orderId = sqlite3_column_int(statement, 0);
-            const unsigned char* raw = sqlite3_column_text(statement, 1);
-            std::string ticker = raw ? reinterpret_cast<const char*>(raw) : "";
-            double price = sqlite3_column_double(statement, 2);
-            double quantity = sqlite3_column_double(statement, 3);
-            int sideInt = sqlite3_column_int(statement, 4);
-            Side side = (sideInt == 0) ? Side::BUY : Side::SELL;
-
-            Order order(orderId, price, quantity, side, ticker);
-
-            if (side == Side::BUY) {
-                buySides[ticker].addOrder(order);
-            } else {
-                sellSides[ticker].addAsk(order);
+    // Apply a journaled event to the in-memory book. Nothing is matched or published:
+    // the effects of matching are replayed from the FILL events that follow each order.
+    void applyEvent(const PersistEvent& event) {
+        switch (event.type) {
+            case PersistEventType::ORDER: {
+                Order order(event.orderId, event.price, event.quantity, event.side, event.ticker);
+                restOrder(order);
+                break;
+            }
+            case PersistEventType::FILL:
+                reduceRestingOrder(event.orderId, event.quantity);
+                reduceRestingOrder(event.matchedOrderId, event.quantity);
+                break;
+            case PersistEventType::CANCEL:
+                cancelOrder(event.orderId);
+                break;
+            case PersistEventType::MODIFY: {
+                Order* existing = findOrder(event.orderId);
+                if (!existing) break;
+                if (event.price == existing->getPrice() && event.quantity <= existing->getQuantity()) {
+                    reduceRestingOrder(event.orderId, existing->getQuantity() - event.quantity);
+                } else {
+                    Order modified(event.orderId, event.price, event.quantity, existing->getSide(), existing->getTicker());
+                    cancelOrder(event.orderId);
+                    restOrder(modified);
+                }
+                break;
             }
         }
-
-        sqlite3_finalize(statement);
     }
 
-
-    // Remove an order from both order book and history by its ID
-    bool removeOrderById(int orderId) {
-    std::string sql = "DELETE FROM ORDERS WHERE ORDER_ID = ?;";
-    sqlite3_stmt *statement;
-
-    if (sqlite3_prepare_v2(DB, sql.c_str(), -1, &statement, nullptr) != SQLITE_OK) {
-        std::cerr << "Failed to prepare delete statement: " << sqlite3_errmsg(DB) << std::endl;
-        return false;
+    // Take quantity off a resting order, removing it once nothing is left
+    void reduceRestingOrder(int orderId, double amount) {
+        Order* existing = findOrder(orderId);
+        if (!existing || amount <= 0) return;
+        if (existing->getQuantity() - amount <= 0) {
+            cancelOrder(orderId);
+            return;
+        }
+        OrderLocation location;
+        locateOrder(orderId, location);
+        existing->reduceQuantity(amount);
+        findLevel(location)->totalQuantity -= amount;
     }
 
-    sqlite3_bind_int(statement, 1, orderId);
 
-    int result = sqlite3_step(statement);
-    sqlite3_finalize(statement);
+    // Find a resting order by ID; returns nullptr if it is not in the book
+    Order* findOrder(int orderId) {
+        OrderLocation location;
+        if (!locateOrder(orderId, location)) {
+            return nullptr;
+        }
+        PriceLevel* level = findLevel(location);
+        if (!level) {
+            return nullptr;
+        }
+        auto it = std::find_if(level->orders.begin(), level->orders.end(),
+            [orderId](const Order& o) { return o.getOrderId() == orderId; });
+        return it != level->orders.end() ? &*it : nullptr;
+    }
 
-    if (result == SQLITE_DONE) {
-        // Check if any row was actually deleted
-        if (sqlite3_changes(DB) > 0) {
-            return true;
-        } else {
-            std::cout << "No order found with ID " << orderId << ". Nothing to remove.\n";
+    // Remove a resting order from the in-memory book only
+    bool cancelOrder(int orderId) {
+        OrderLocation location;
+        if (!locateOrder(orderId, location)) {
             return false;
         }
-    } else {
-        std::cerr << "Error deleting order: " << sqlite3_errmsg(DB) << std::endl;
-        return false;
-    }
-}
-    void displayOrders() const {
-    const char* sql = "SELECT ORDER_ID, TICKER, PRICE, QUANTITY, SIDE FROM ORDERS;";
-    sqlite3_stmt* statement;
-
-    int rc = sqlite3_prepare_v2(DB, sql, -1, &statement, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(DB) << std::endl;
-        return;
+        unindexOrder(orderId);
+
+        if (location.side == Side::BUY) {
+            auto& bids = bidsFor(location.ticker).bids;
+            auto level = bids.find(location.price);
+            if (level == bids.end()) return false;
+            level->second.removeOrder(orderId);
+            if (level->second.isEmpty()) bids.erase(level);
+        } else {
+            auto& asks = asksFor(location.ticker).asks;
+            auto level = asks.find(location.price);
+            if (level == asks.end()) return false;
+            level->second.removeOrder(orderId);
+            if (level->second.isEmpty()) asks.erase(level);
+        }
+        return true;
     }
 
-    // Print headers
-    std::cout << std::left
-              << std::setw(10) << "ORDER_ID"
-              << std::setw(12) << "TICKER"
-              << std::setw(12) << "PRICE"
-              << std::setw(12) << "QUANTITY"
-              << std::setw(8) << "SIDE" << std::endl;
-
-    std::cout << std::string(54, '-') << std::endl;
-
-    bool hasRows = false;
+    // Change price and/or quantity of a resting order.
+    // Reducing quantity at the same price keeps time priority; anything else re-queues the order.
+    bool modifyOrder(int orderId, double newPrice, double newQuantity) {
+        Order* existing = findOrder(orderId);
+        if (!existing || newQuantity <= 0) {
+            return false;
+        }
 
-    while (sqlite3_step(statement) == SQLITE_ROW) {
-        hasRows = true;
-        int orderId = sqlite3_column_int(statement, 0);
-        const unsigned char* rawTicker = sqlite3_column_text(statement, 1);
-        std::string ticker = rawTicker ? reinterpret_cast<const char*>(rawTicker) : "";
-        double price = sqlite3_column_double(statement, 2);
-        double quantity = sqlite3_column_double(statement, 3);
-        int sideInt = sqlite3_column_int(statement, 4);
-        std::string sideStr = (sideInt == 0) ? "BUY" : "SELL";
+        // Record the change before any fills the re-queued order may produce
+        Order modified(orderId, newPrice, newQuantity, existing->getSide(), existing->getTicker());
+        publish(PersistEvent::make(PersistEventType::MODIFY, modified));
 
-        std::cout << std::left
-                  << std::setw(10) << orderId
-                  << std::setw(12) << ticker
-                  << std::setw(12) << price
-                  << std::setw(12) << quantity
-                  << std::setw(8) << sideStr << std::endl;
+        if (newPrice == existing->getPrice() && newQuantity <= existing->getQuantity()) {
+            reduceRestingOrder(orderId, existing->getQuantity() - newQuantity);
+        } else {
+            cancelOrder(orderId);
+            matchOrder(modified);
+        }
+        return true;
     }
 
-    sqlite3_finalize(statement);
+    // Remove an order from both order book and history by its ID
+    bool removeOrderById(int orderId) {
+        Order* existing = findOrder(orderId);
+        if (!existing) {
+            std::cout << "No order found with ID " << orderId << ". Nothing to remove.\n";
+            return false;
+        }
 
-    if (!hasRows) {
-        std::cout << "No orders stored yet.\n";
+        publish(PersistEvent::make(PersistEventType::CANCEL, *existing));
+        cancelOrder(orderId);
+        return true;
     }
-}
-
 
     void displayActiveTickers(const std::string& user_ticker) const {
         std::cout << "\nActive Orders for Ticker: " << user_ticker << "\n";
@@ -399,6 +568,7 @@ public:
         bool foundOrders = false;
 
         // Display BUY side orders
+        std::shared_lock<std::shared_mutex> symbolsLock(symbolsMutex);
         auto buyIt = buySides.find(user_ticker);
         if (buyIt != buySides.end()) {
             for (const auto& [price, level] : buyIt->second.bids) {
@@ -432,6 +602,28 @@ public:
             std::cout << "No active orders found for ticker " << user_ticker << ".\n";
         };
     }
+
+private:
+    // Report a trade between an incoming order and a resting one
+    void publishFill(const Order& incoming, int restingOrderId, double price, double quantity) {
+        PersistEvent event = PersistEvent::make(PersistEventType::FILL, incoming);
+        event.matchedOrderId = restingOrderId;
+        event.price = price;
+        event.quantity = quantity;
+        publish(event);
+    }
+
+    // Locate the price level holding an indexed order
+    PriceLevel* findLevel(const OrderLocation& location) {
+        if (location.side == Side::BUY) {
+            auto& bids = bidsFor(location.ticker).bids;
+            auto level = bids.find(location.price);
+            return level != bids.end() ? &level->second : nullptr;
+        }
+        auto& asks = asksFor(location.ticker).asks;
+        auto level = asks.find(location.price);
+        return level != asks.end() ? &level->second : nullptr;
+    }
 };
 
 
@@ -0,0 +1,161 @@
+#ifndef PARALLELLOAD_H
+#define PARALLELLOAD_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "orderbook.hpp"
+
+// Order IDs scanned per chunk by each loader connection
+constexpr int LOAD_CHUNK_IDS = 65536;
+
+// One live order read from history, kept flat so partitions are cheap to move around
+struct LoadedOrder {
+    int orderId;
+    double price;
+    double quantity;
+    Side side;
+    char ticker[TICKER_SIZE];
+};
+
+// Symbols built by one worker, published into the book once every worker is done
+struct LoadPartition {
+    std::unordered_map<std::string, OrderBookBuySide> buySides;
+    std::unordered_map<std::string, OrderBookSellSide> sellSides;
+    std::vector<std::pair<int, OrderLocation>> locations;
+};
+
+// Load the live orders in the SQLite history at dbPath into an empty book using several threads.
+// Each thread opens its own read-only connection and scans ORDER_ID ranges in chunks,
+// sorting rows into partitions by ticker. Each partition is then built into its own
+// symbol books by one thread, and the finished books are moved into the order book together.
+// Returns false, leaving the book untouched, if a connection cannot be opened.
+inline bool loadOrdersParallel(const std::string& dbPath, OrderBook& book, std::size_t threadCount) {
+    threadCount = std::max<std::size_t>(threadCount, 1);
+
+    // This connection stays open until the scan is done, so the scanners attach to its WAL
+    // index rather than racing each other to set one up when nothing else has the file open
+    int maxOrderId = 0;
+    sqlite3* anchor = nullptr;
+    sqlite3_stmt* maxIdStatement = nullptr;
+    if (sqlite3_open_v2(dbPath.c_str(), &anchor, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK
+        || sqlite3_prepare_v2(anchor, "SELECT COALESCE(MAX(ORDER_ID), 0) FROM ORDERS;", -1, &maxIdStatement, nullptr) != SQLITE_OK) {
+        sqlite3_close(anchor);
+        return false;
+    }
+    if (sqlite3_step(maxIdStatement) == SQLITE_ROW) {
+        maxOrderId = sqlite3_column_int(maxIdStatement, 0);
+    }
+    sqlite3_finalize(maxIdStatement);
+
+    // Scan: rows[scanner][partition]
+    std::vector<std::vector<std::vector<LoadedOrder>>> rows(
+        threadCount, std::vector<std::vector<LoadedOrder>>(threadCount));
+    std::atomic<int> nextChunkStart{1};
+    std::atomic<bool> failed{false};
+
+    auto scan = [&](std::size_t scanner) {
+        sqlite3* db = nullptr;
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK
+            || sqlite3_prepare_v2(db,
+                   "SELECT ORDER_ID, TICKER, PRICE, REMAINING, SIDE FROM ORDERS "
+                   "WHERE REMAINING > 0 AND ORDER_ID >= ? AND ORDER_ID < ?;", -1, &statement, nullptr) != SQLITE_OK) {
+            std::cerr << "Loader failed to open " << dbPath << ": " << sqlite3_errmsg(db) << std::endl;
+            failed = true;
+            sqlite3_close(db);
+            return;
+        }
+
+        auto& partitions = rows[scanner];
+        for (int start = nextChunkStart.fetch_add(LOAD_CHUNK_IDS); start <= maxOrderId;
+             start = nextChunkStart.fetch_add(LOAD_CHUNK_IDS)) {
+            sqlite3_bind_int(statement, 1, start);
+            sqlite3_bind_int(statement, 2, start + LOAD_CHUNK_IDS);
+            while (sqlite3_step(statement) == SQLITE_ROW) {
+                LoadedOrder row{};
+                row.orderId = sqlite3_column_int(statement, 0);
+                const unsigned char* raw = sqlite3_column_text(statement, 1);
+                std::size_t length = std::min<std::size_t>(sqlite3_column_bytes(statement, 1), TICKER_SIZE - 1);
+                if (raw) std::memcpy(row.ticker, raw, length);
+                row.price = sqlite3_column_double(statement, 2);
+                row.quantity = sqlite3_column_double(statement, 3);
+                row.side = sqlite3_column_int(statement, 4) == 0 ? Side::BUY : Side::SELL;
+
+                std::size_t partition = std::hash<std::string_view>{}(std::string_view(row.ticker, length)) % threadCount;
+                partitions[partition].push_back(row);
+            }
+            sqlite3_reset(statement);
+        }
+        sqlite3_finalize(statement);
+        sqlite3_close(db);
+    };
+
+    // Build: each partition's rows, in order ID (time priority) order, into private books
+    std::vector<LoadPartition> built(threadCount);
+    auto build = [&](std::size_t partition) {
+        std::vector<LoadedOrder> orders;
+        std::size_t total = 0;
+        for (const auto& scanned : rows) total += scanned[partition].size();
+        orders.reserve(total);
+        for (auto& scanned : rows) {
+            orders.insert(orders.end(), scanned[partition].begin(), scanned[partition].end());
+            std::vector<LoadedOrder>().swap(scanned[partition]);
+        }
+        std::sort(orders.begin(), orders.end(),
+                  [](const LoadedOrder& a, const LoadedOrder& b) { return a.orderId < b.orderId; });
+
+        LoadPartition& result = built[partition];
+        result.locations.reserve(orders.size());
+        for (const LoadedOrder& row : orders) {
+            Order order(row.orderId, row.price, row.quantity, row.side, row.ticker);
+            if (row.side == Side::BUY) {
+                result.buySides[row.ticker].addOrder(order);
+            } else {
+                result.sellSides[row.ticker].addAsk(order);
+            }
+            result.locations.push_back({row.orderId, {row.ticker, row.side, row.price}});
+        }
+    };
+
+    auto runOnThreads = [threadCount](const std::function<void(std::size_t)>& task) {
+        std::vector<std::thread> workers;
+        workers.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back(task, i);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    };
+    runOnThreads(scan);
+    sqlite3_close(anchor);
+    if (failed) {
+        return false;
+    }
+    runOnThreads(build);
+
+    // Publish: partitions hold disjoint tickers, so the maps can be spliced in as they are
+    std::unique_lock<std::shared_mutex> symbolsLock(book.symbolsMutex);
+    std::lock_guard<std::mutex> indexLock(book.indexMutex);
+    for (LoadPartition& partition : built) {
+        book.buySides.merge(partition.buySides);
+        book.sellSides.merge(partition.sellSides);
+        book.orderIndex.reserve(book.orderIndex.size() + partition.locations.size());
+        for (auto& [orderId, location] : partition.locations) {
+            book.orderIndex.emplace(orderId, std::move(location));
+        }
+    }
+    book.lastOrderId = std::max(book.lastOrderId, maxOrderId);
+    return true;
+}
+
+#endif // PARALLELLOAD_H
@@ -0,0 +1,163 @@
+#ifndef PERSISTENCE_H
+#define PERSISTENCE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "orderbook.hpp"
+#include "ringbuffer.hpp"
+
+// When a command is acknowledged relative to its history being written
+enum class DurabilityMode {
+    AFTER_MATCH,  // Acknowledge as soon as matching is done; history is written behind
+    AFTER_COMMIT  // Acknowledge only once the command's events are committed to the DB
+};
+
+constexpr std::size_t PERSISTENCE_RING_CAPACITY = 16384;
+
+// When a group-commit window closes. A window opens with the first event after a
+// commit and is committed once it holds maxBatchSize events or maxDelay has passed.
+struct GroupCommitPolicy {
+    std::size_t maxBatchSize = 1000;
+    std::chrono::microseconds maxDelay{1000};
+};
+
+// Summary of one committed window, handed to the batch completion callback
+struct CommitBatch {
+    std::uint64_t batchNumber;
+    std::size_t events;
+    std::chrono::nanoseconds elapsed;  // From window open to commit done
+};
+
+// Persistence pipeline stage: matcher threads publish events into a lock-free ring,
+// and a single writer thread drains them into an EventSink in group-commit windows.
+class PersistenceWriter : public EventPublisher {
+public:
+    using BatchCallback = std::function<void(const CommitBatch&)>;
+
+    PersistenceWriter(EventSink& sink, DurabilityMode mode, GroupCommitPolicy policy = {},
+                      BatchCallback onBatch = nullptr)
+        : sink_(sink), mode_(mode), policy_(policy), onBatch_(std::move(onBatch)) {
+        if (policy_.maxBatchSize == 0) policy_.maxBatchSize = 1;
+        batch_.reserve(std::min<std::size_t>(policy_.maxBatchSize, PERSISTENCE_RING_CAPACITY));
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~PersistenceWriter() override {
+        stop_.store(true, std::memory_order_release);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    PersistenceWriter(const PersistenceWriter&) = delete;
+    PersistenceWriter& operator=(const PersistenceWriter&) = delete;
+
+    void publish(const PersistEvent& event) override {
+        ring_.push(event);
+    }
+
+    // Block until every event published so far has been committed
+    void waitUntilDurable() {
+        std::size_t target = ring_.claimed();
+        std::unique_lock<std::mutex> lock(commitMutex_);
+        commitCv_.wait(lock, [this, target] { return committed_ >= target; });
+    }
+
+    [[nodiscard]] DurabilityMode mode() const { return mode_; }
+
+private:
+    void run() {
+        PersistEvent event;
+        unsigned idleRounds = 0;
+        while (true) {
+            if (!ring_.tryPop(event)) {
+                if (stop_.load(std::memory_order_acquire) && ring_.empty()) {
+                    return;
+                }
+                if (idleRounds++ < 128) {
+                    cpuRelax();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                continue;
+            }
+            idleRounds = 0;
+
+            // Keep the transaction open until the window is full or its time is up
+            auto windowStart = std::chrono::steady_clock::now();
+            auto deadline = windowStart + policy_.maxDelay;
+            batch_.clear();
+            sink_.beginBatch();
+            sink_.writeEvent(event);
+            batch_.push_back(event);
+            while (batch_.size() < policy_.maxBatchSize) {
+                if (ring_.tryPop(event)) {
+                    sink_.writeEvent(event);
+                    batch_.push_back(event);
+                } else if (stop_.load(std::memory_order_acquire) || std::chrono::steady_clock::now() >= deadline) {
+                    break;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            if (!commitWithRetry()) {
+                return;
+            }
+            std::size_t batchSize = batch_.size();
+
+            {
+                std::lock_guard<std::mutex> lock(commitMutex_);
+                committed_ += batchSize;
+            }
+            commitCv_.notify_all();
+
+            if (onBatch_) {
+                onBatch_({++batches_, batchSize, std::chrono::steady_clock::now() - windowStart});
+            }
+        }
+    }
+
+    // Commit the open batch. A failed commit stores nothing, so the same events are written
+    // again, with growing pauses, until one succeeds; nothing is acknowledged meanwhile.
+    // Gives up only when stopping, leaving the events to the journal replay at next startup.
+    bool commitWithRetry() {
+        auto pause = std::chrono::milliseconds(10);
+        while (!sink_.commitBatch()) {
+            if (stop_.load(std::memory_order_acquire)) {
+                std::cerr << "Order history could not store its last " << batch_.size()
+                          << " events or any still queued; they are replayed from the journal at next startup." << std::endl;
+                return false;
+            }
+            std::this_thread::sleep_for(pause);
+            pause = std::min(pause * 2, std::chrono::milliseconds(1000));
+            sink_.beginBatch();
+            for (const PersistEvent& pending : batch_) {
+                sink_.writeEvent(pending);
+            }
+        }
+        return true;
+    }
+
+    MPSCRingBuffer<PersistEvent, PERSISTENCE_RING_CAPACITY> ring_;
+    EventSink& sink_;
+    DurabilityMode mode_;
+    GroupCommitPolicy policy_;
+    BatchCallback onBatch_;
+    std::uint64_t batches_ = 0;
+    std::vector<PersistEvent> batch_;  // Events of the open batch, kept until it commits
+    std::mutex commitMutex_;
+    std::condition_variable commitCv_;
+    std::size_t committed_ = 0;  // Number of events committed, in ring order
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+#endif // PERSISTENCE_H
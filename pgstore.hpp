@@ -0,0 +1,273 @@
+#ifndef PGSTORE_H
+#define PGSTORE_H
+
+// PostgreSQL order history, built when CMake finds libpqxx and defines ORDERBOOK_HAS_POSTGRES
+#ifdef ORDERBOOK_HAS_POSTGRES
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <pqxx/pqxx>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "orderbook.hpp"
+#include "storage.hpp"
+
+// Order history in PostgreSQL, fed by the persistence stage like the SQLite store.
+// Each batch is one transaction: new orders and fills are bulk-loaded with COPY into
+// session-local staging tables and merged with a single upsert each, cancels and
+// modifies go out as prepared statements in one pipeline, and remaining quantities
+// are then brought up to date from the new trades with one set-based UPDATE.
+// The schema and the replay rules (trade_id = journal sequence, filled_through) are
+// the same as for SQLite, so replaying the journal into it is idempotent.
+class PostgresStore : public StorageBackend {
+public:
+    [[nodiscard]] const char* name() const override { return "postgres"; }
+
+    bool open(const std::string& connectionString) {
+        try {
+            connectionString_ = connectionString;
+            connection_ = std::make_unique<pqxx::connection>(connectionString);
+            pqxx::work tx{*connection_};
+            tx.exec(
+                "CREATE TABLE IF NOT EXISTS orders("
+                " order_id INTEGER PRIMARY KEY,"
+                " ticker TEXT NOT NULL,"
+                " price DOUBLE PRECISION NOT NULL,"
+                " quantity DOUBLE PRECISION NOT NULL,"
+                " side SMALLINT NOT NULL,"
+                " remaining DOUBLE PRECISION NOT NULL,"
+                " filled_through BIGINT NOT NULL,"
+                " created_at TIMESTAMPTZ NOT NULL DEFAULT now());"
+                "CREATE TABLE IF NOT EXISTS trades("
+                " trade_id BIGINT PRIMARY KEY,"
+                " ticker TEXT NOT NULL,"
+                " buy_order_id INTEGER NOT NULL,"
+                " sell_order_id INTEGER NOT NULL,"
+                " price DOUBLE PRECISION NOT NULL,"
+                " quantity DOUBLE PRECISION NOT NULL);"
+                "CREATE TABLE IF NOT EXISTS meta("
+                " key TEXT PRIMARY KEY,"
+                " value BIGINT NOT NULL);"
+                "CREATE INDEX IF NOT EXISTS trades_buy_order ON trades(buy_order_id, trade_id);"
+                "CREATE INDEX IF NOT EXISTS trades_sell_order ON trades(sell_order_id, trade_id);"
+                "CREATE INDEX IF NOT EXISTS orders_live ON orders(order_id) WHERE remaining > 0;"
+                "CREATE INDEX IF NOT EXISTS orders_by_ticker ON orders(ticker, order_id);");
+            lastTradeId_ = tx.query_value<std::int64_t>("SELECT COALESCE(MAX(trade_id), 0) FROM trades;");
+            tx.commit();
+
+            prepareSession();
+            watermark_.reset(journalSequence());
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to open PostgreSQL order history: " << e.what() << std::endl;
+            connection_.reset();
+            return false;
+        }
+        return true;
+    }
+
+    // Highest journal sequence number already written (0 if none)
+    std::uint64_t journalSequence() override {
+        pqxx::read_transaction tx{*connection_};
+        return tx.query_value<std::int64_t>(
+            "SELECT COALESCE((SELECT value FROM meta WHERE key = 'journal_sequence'), 0);");
+    }
+
+    // Rebuild the book from the orders that still have quantity open
+    void loadLiveOrders(OrderBook& book) override {
+        pqxx::read_transaction tx{*connection_};
+        book.lastOrderId = std::max(book.lastOrderId,
+            tx.query_value<int>("SELECT COALESCE(MAX(order_id), 0) FROM orders;"));
+        pqxx::result rows = tx.exec(
+            "SELECT order_id, ticker, price, remaining, side FROM orders WHERE remaining > 0 ORDER BY order_id;");
+        for (const auto& row : rows) {
+            Side side = row[4].as<int>() == 0 ? Side::BUY : Side::SELL;
+            Order order(row[0].as<int>(), row[2].as<double>(), row[3].as<double>(), side, row[1].as<std::string>());
+            book.restOrder(order);
+        }
+    }
+
+    // Empty every history table; used by the storage benchmark
+    bool truncate() {
+        try {
+            pqxx::work tx{*connection_};
+            tx.exec("TRUNCATE orders, trades, meta;");
+            tx.commit();
+            lastTradeId_ = 0;
+            watermark_.reset(0);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to truncate PostgreSQL order history: " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void beginBatch() override {
+        watermarkAtBegin_ = watermark_;
+        tradeIdAtBegin_ = lastTradeId_;
+        orders_.clear();
+        trades_.clear();
+        updates_.clear();
+    }
+
+    void writeEvent(const PersistEvent& event) override {
+        watermark_.note(event.sequence);
+        PersistEvent stamped = event;
+        // Events written without a journal are numbered after the newest trade
+        if (stamped.sequence == 0) {
+            stamped.sequence = static_cast<std::uint64_t>(++lastTradeId_);
+        } else {
+            lastTradeId_ = std::max(lastTradeId_, static_cast<std::int64_t>(stamped.sequence));
+        }
+
+        switch (stamped.type) {
+            case PersistEventType::ORDER: orders_.push_back(stamped); break;
+            case PersistEventType::FILL: trades_.push_back(stamped); break;
+            case PersistEventType::CANCEL:
+            case PersistEventType::MODIFY: updates_.push_back(stamped); break;
+        }
+    }
+
+    bool commitBatch() override {
+        if (!connection_ && !reconnect()) return false;
+        try {
+            pqxx::work tx{*connection_};
+            copyOrders(tx);
+            std::int64_t firstTrade = copyTrades(tx);
+
+            if (!updates_.empty()) {
+                pqxx::pipeline pipe{tx};
+                for (const PersistEvent& event : updates_) {
+                    if (event.type == PersistEventType::CANCEL) {
+                        pipe.insert("EXECUTE cancel_order(" + tx.quote(event.orderId) + ");");
+                    } else {
+                        pipe.insert("EXECUTE modify_order(" + tx.quote(event.price) + ", " + tx.quote(event.quantity)
+                                    + ", " + tx.quote(event.orderId) + ", " + tx.quote(event.sequence) + ");");
+                    }
+                }
+                pipe.complete();
+            }
+
+            if (firstTrade > 0) {
+                tx.exec_prepared("apply_fills", firstTrade);
+            }
+            if (watermark_.advanced()) {
+                tx.exec_prepared("update_journal_sequence", static_cast<std::int64_t>(watermark_.highWater()));
+            }
+            tx.commit();
+            watermark_.markCommitted();
+        } catch (const std::exception& e) {
+            std::cerr << "Error committing order history to PostgreSQL: " << e.what() << std::endl;
+            // Nothing in this batch was stored: forget it, so the caller's retry writes it again
+            // and the stored journal_sequence never covers events that are not in the tables
+            watermark_ = watermarkAtBegin_;
+            lastTradeId_ = tradeIdAtBegin_;
+            if (!connection_->is_open()) {
+                reconnect();
+            }
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // Session state that a new connection has to set up again: staging tables and statements
+    void prepareSession() {
+        // Staging tables live for the session and are emptied by every commit
+        {
+            pqxx::nontransaction session{*connection_};
+            session.exec(
+                "CREATE TEMP TABLE IF NOT EXISTS orders_stage("
+                " order_id INTEGER, ticker TEXT, price DOUBLE PRECISION, quantity DOUBLE PRECISION,"
+                " side SMALLINT, filled_through BIGINT) ON COMMIT DELETE ROWS;"
+                "CREATE TEMP TABLE IF NOT EXISTS trades_stage("
+                " trade_id BIGINT, ticker TEXT, buy_order_id INTEGER, sell_order_id INTEGER,"
+                " price DOUBLE PRECISION, quantity DOUBLE PRECISION) ON COMMIT DELETE ROWS;");
+        }
+
+        connection_->prepare("cancel_order", "DELETE FROM orders WHERE order_id = $1;");
+        connection_->prepare("modify_order",
+            "UPDATE orders SET price = $1, quantity = $2, remaining = $2, filled_through = $4 WHERE order_id = $3;");
+        connection_->prepare("apply_fills",
+            "UPDATE orders o SET"
+            " remaining = GREATEST(ROUND((o.remaining - f.quantity)::numeric, 9)::float8, 0),"
+            " filled_through = GREATEST(o.filled_through, f.last_trade) "
+            "FROM (SELECT t.order_id, SUM(t.quantity) AS quantity, MAX(t.trade_id) AS last_trade"
+            "      FROM (SELECT buy_order_id AS order_id, trade_id, quantity FROM trades WHERE trade_id >= $1"
+            "            UNION ALL"
+            "            SELECT sell_order_id, trade_id, quantity FROM trades WHERE trade_id >= $1) t"
+            "      JOIN orders p ON p.order_id = t.order_id AND t.trade_id > p.filled_through"
+            "      GROUP BY t.order_id) f "
+            "WHERE o.order_id = f.order_id;");
+        connection_->prepare("update_journal_sequence",
+            "INSERT INTO meta (key, value) VALUES ('journal_sequence', $1) "
+            "ON CONFLICT (key) DO UPDATE SET value = EXCLUDED.value;");
+    }
+
+    // Replace a connection the server dropped, so the persistence stage's retry can succeed
+    bool reconnect() {
+        try {
+            connection_ = std::make_unique<pqxx::connection>(connectionString_);
+            prepareSession();
+        } catch (const std::exception& e) {
+            std::cerr << "Could not reconnect to PostgreSQL order history: " << e.what() << std::endl;
+            connection_.reset();
+            return false;
+        }
+        std::cerr << "Reconnected to PostgreSQL order history." << std::endl;
+        return true;
+    }
+
+    // COPY new orders into staging and merge them; a replayed order is reset to its placed size
+    void copyOrders(pqxx::work& tx) {
+        if (orders_.empty()) return;
+        auto stream = pqxx::stream_to::table(tx, {"orders_stage"},
+            {"order_id", "ticker", "price", "quantity", "side", "filled_through"});
+        for (const PersistEvent& event : orders_) {
+            stream.write_values(event.orderId, std::string_view(event.ticker), event.price, event.quantity,
+                                static_cast<int>(event.side), static_cast<std::int64_t>(event.sequence));
+        }
+        stream.complete();
+        tx.exec(
+            "INSERT INTO orders (order_id, ticker, price, quantity, side, remaining, filled_through) "
+            "SELECT order_id, ticker, price, quantity, side, quantity, filled_through FROM orders_stage "
+            "ON CONFLICT (order_id) DO UPDATE SET ticker = EXCLUDED.ticker, price = EXCLUDED.price,"
+            " quantity = EXCLUDED.quantity, side = EXCLUDED.side, remaining = EXCLUDED.remaining,"
+            " filled_through = EXCLUDED.filled_through;");
+    }
+
+    // COPY new trades into staging and merge them; returns the lowest trade ID written, or 0
+    std::int64_t copyTrades(pqxx::work& tx) {
+        if (trades_.empty()) return 0;
+        std::int64_t firstTrade = static_cast<std::int64_t>(trades_.front().sequence);
+        auto stream = pqxx::stream_to::table(tx, {"trades_stage"},
+            {"trade_id", "ticker", "buy_order_id", "sell_order_id", "price", "quantity"});
+        for (const PersistEvent& event : trades_) {
+            bool incomingBuys = event.side == Side::BUY;
+            stream.write_values(static_cast<std::int64_t>(event.sequence), std::string_view(event.ticker),
+                                incomingBuys ? event.orderId : event.matchedOrderId,
+                                incomingBuys ? event.matchedOrderId : event.orderId,
+                                event.price, event.quantity);
+            firstTrade = std::min(firstTrade, static_cast<std::int64_t>(event.sequence));
+        }
+        stream.complete();
+        tx.exec("INSERT INTO trades SELECT * FROM trades_stage ON CONFLICT (trade_id) DO NOTHING;");
+        return firstTrade;
+    }
+
+    std::string connectionString_;
+    std::unique_ptr<pqxx::connection> connection_;
+    std::vector<PersistEvent> orders_;
+    std::vector<PersistEvent> trades_;
+    std::vector<PersistEvent> updates_;
+    std::int64_t lastTradeId_ = 0;
+    std::int64_t tradeIdAtBegin_ = 0;
+    JournalWatermark watermark_;         // Stored in meta as journal_sequence
+    JournalWatermark watermarkAtBegin_;  // Restored if the batch fails to commit
+};
+
+#endif // ORDERBOOK_HAS_POSTGRES
+
+#endif // PGSTORE_H
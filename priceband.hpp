@@ -0,0 +1,49 @@
+#ifndef PRICEBAND_H
+#define PRICEBAND_H
+
+#include <atomic>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "priceservice.hpp"
+
+// Fat-finger check run at ingress, before an order reaches matching: an order priced more
+// than a set percentage away from the symbol's latest reference price is refused, so it
+// never rests as an outlier price level. Symbols without a reference price yet are not
+// checked. Thread-safe; reads prices from the service's lock-free cache.
+class PriceBand {
+public:
+    // percent <= 0 disables the check
+    PriceBand(const PriceService& prices, double percent)
+        : prices_(prices), fraction_(percent / 100.0) {}
+
+    [[nodiscard]] bool enabled() const { return fraction_ > 0; }
+
+    // True if price is within the band around reference: one comparison, no branches
+    [[nodiscard]] bool within(double price, double reference) const {
+        return std::fabs(price - reference) <= fraction_ * reference;
+    }
+
+    // Why price is outside the band for ticker, or empty if it is inside or cannot be judged
+    [[nodiscard]] std::string check(std::string_view ticker, double price) const {
+        if (!enabled()) return "";
+        ReferencePrice reference;
+        if (!prices_.latest(ticker, reference) || within(price, reference.close)) return "";
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        std::ostringstream reason;
+        reason << "Price " << price << " is more than " << fraction_ * 100 << "% away from the " << ticker
+               << " reference price " << reference.close << ".";
+        return reason.str();
+    }
+
+    // Orders refused so far
+    [[nodiscard]] std::size_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+    const PriceService& prices_;
+    double fraction_;
+    mutable std::atomic<std::size_t> rejected_{0};
+};
+
+#endif // PRICEBAND_H
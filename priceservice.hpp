@@ -0,0 +1,422 @@
+#ifndef PRICESERVICE_H
+#define PRICESERVICE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <curl/curl.h>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "command.hpp"
+#include "json.hpp"  // from https://github.com/nlohmann/json
+#include "numparse.hpp"
+
+// Latest reference price of one symbol
+struct ReferencePrice {
+    double close = 0;
+    std::int64_t barTime = 0;    // Start of the bar, ms since the epoch (in the feed's exchange time)
+    std::int64_t fetchedAt = 0;  // When it arrived, ms since the epoch
+};
+
+// Parse an AlphaVantage bar time, "YYYY-MM-DD HH:MM:SS", into ms since the epoch
+inline bool parseBarTime(const std::string& text, std::int64_t& millis) {
+    std::tm tm{};
+    if (std::sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                    &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return false;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    millis = static_cast<std::int64_t>(timegm(&tm)) * 1000;
+    return true;
+}
+
+// SAX handler that picks the close of the first bar out of an AlphaVantage intraday
+// response and stops the parse there. AlphaVantage lists bars newest first, so the first
+// bar is the latest and the rest of the series is never parsed. No document is built.
+// Top-level string values are kept as the error when the series is missing, since that
+// is how AlphaVantage reports rate limits and bad keys ({"Note": "..."}).
+struct IntradayCloseHandler {
+    using json = nlohmann::json;
+
+    ReferencePrice price;
+    bool found = false;
+    std::string error;
+
+    bool null() { return true; }
+    bool boolean(bool) { return true; }
+    bool number_integer(json::number_integer_t) { return true; }
+    bool number_unsigned(json::number_unsigned_t) { return true; }
+    bool number_float(json::number_float_t, const json::string_t&) { return true; }
+    bool binary(json::binary_t&) { return true; }
+
+    bool string(json::string_t& text) {
+        if (depth_ == 1 && error.empty()) {
+            error = key_ + ": " + text;
+        }
+        if (inBar_ && key_ == "4. close") {
+            Decimal close;
+            if (!parseDecimal(text, close)) {
+                error = "bad close '" + text + "'";
+                return false;
+            }
+            price.close = toDouble(close);
+            found = true;
+            return false;  // Done; stop parsing
+        }
+        return true;
+    }
+
+    bool key(json::string_t& name) {
+        key_ = name;
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        ++depth_;
+        if (depth_ == 2 && key_ == "Time Series (5min)") {
+            inSeries_ = true;
+        } else if (depth_ == 3 && inSeries_) {
+            if (!parseBarTime(key_, price.barTime)) {
+                error = "bad bar time '" + key_ + "'";
+                return false;
+            }
+            inBar_ = true;
+        }
+        return true;
+    }
+
+    bool end_object() {
+        if (inBar_ && depth_ == 3) {
+            error = "first bar has no close";
+            return false;
+        }
+        if (inSeries_ && depth_ == 2) {
+            error = "empty 'Time Series (5min)'";
+            return false;
+        }
+        --depth_;
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        ++depth_;
+        return true;
+    }
+
+    bool end_array() {
+        --depth_;
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& e) {
+        error = "JSON error at byte " + std::to_string(position) + ": " + e.what();
+        return false;
+    }
+
+private:
+    int depth_ = 0;
+    bool inSeries_ = false;
+    bool inBar_ = false;
+    std::string key_;
+};
+
+// Close of the most recent bar in an AlphaVantage TIME_SERIES_INTRADAY (5min) response.
+// On failure error says why: the service's own message (rate limit note, bad key) or bad JSON.
+inline bool parseIntradayClose(const std::string& body, ReferencePrice& price, std::string& error) {
+    IntradayCloseHandler handler;
+    nlohmann::json::sax_parse(body, &handler);
+    if (!handler.found) {
+        error = handler.error.empty() ? "'Time Series (5min)' not found in response" : handler.error;
+        return false;
+    }
+    price = handler.price;
+    return true;
+}
+
+// How the price service fetches
+struct PriceServicePolicy {
+    std::chrono::seconds refreshInterval{60};  // Time between fetches of one symbol
+    std::size_t maxConcurrent = 8;             // Requests in flight at once
+    long timeoutSeconds = 10;                  // Per request
+};
+
+// Background reference prices for a watchlist.
+// One thread drives every request through a curl multi handle, so the whole watchlist is
+// fetched concurrently, and refreshes each symbol every refreshInterval. Symbols are added
+// with watch() and fetched as soon as they are added.
+// Prices live in a fixed table of slots. A slot's ticker is written once, before the slot is
+// published, and its price is updated under a per-slot sequence counter, so latest() never
+// takes a lock: it retries only if it raced the fetch thread's update of that same slot.
+class PriceService {
+public:
+    static constexpr std::size_t CAPACITY = 4096;  // Watchlist limit is three quarters of this
+
+    PriceService(std::string baseUrl, std::string apiKey, PriceServicePolicy policy = {})
+        : baseUrl_(std::move(baseUrl)), apiKey_(std::move(apiKey)), policy_(policy), slots_(CAPACITY) {}
+
+    ~PriceService() {
+        stop();
+    }
+
+    PriceService(const PriceService&) = delete;
+    PriceService& operator=(const PriceService&) = delete;
+
+    bool start() {
+        if (thread_.joinable()) return true;
+        multi_ = curl_multi_init();
+        if (!multi_) {
+            std::cerr << "Failed to init curl multi handle\n";
+            return false;
+        }
+        curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(policy_.maxConcurrent));
+        stopping_ = false;
+        thread_ = std::thread([this] { run(); });
+        return true;
+    }
+
+    void stop() {
+        if (!thread_.joinable()) return;
+        stopping_ = true;
+        curl_multi_wakeup(multi_);
+        thread_.join();
+        curl_multi_cleanup(multi_);
+        multi_ = nullptr;
+    }
+
+    // Add a ticker to the watchlist. False if it is too long or the watchlist is full.
+    bool watch(const std::string& ticker) {
+        if (ticker.empty() || ticker.size() >= COMMAND_TICKER_SIZE) return false;
+        {
+            std::lock_guard<std::mutex> lock(watchMutex_);
+            std::size_t index = probe(ticker);
+            if (slots_[index].ready.load(std::memory_order_acquire)) {
+                return true;  // Already watched
+            }
+            if (watched_ >= CAPACITY / 4 * 3) {
+                return false;
+            }
+            Slot& slot = slots_[index];
+            std::memcpy(slot.ticker, ticker.c_str(), ticker.size() + 1);
+            slot.ready.store(true, std::memory_order_release);
+            ++watched_;
+            added_.push_back(index);
+        }
+        if (multi_) {
+            curl_multi_wakeup(multi_);
+        }
+        return true;
+    }
+
+    // The most recent price fetched for ticker; false if it is not watched or nothing has arrived yet
+    bool latest(std::string_view ticker, ReferencePrice& price) const {
+        if (ticker.empty() || ticker.size() >= COMMAND_TICKER_SIZE) return false;
+        const Slot& slot = slots_[probe(ticker)];
+        if (!slot.ready.load(std::memory_order_acquire)) return false;
+        while (true) {
+            std::uint32_t before = slot.version.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            price.close = slot.close.load(std::memory_order_relaxed);
+            price.barTime = slot.barTime.load(std::memory_order_relaxed);
+            price.fetchedAt = slot.fetchedAt.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.version.load(std::memory_order_relaxed) == before) break;
+        }
+        return price.fetchedAt != 0;
+    }
+
+    // Requests completed with a price, and requests that failed
+    [[nodiscard]] std::size_t fetches() const { return fetches_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::size_t failures() const { return failures_.load(std::memory_order_relaxed); }
+
+    // Why the most recent failed request failed, prefixed with its ticker; empty if none has
+    [[nodiscard]] std::string lastError() const {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        return lastError_;
+    }
+
+private:
+    struct Slot {
+        std::atomic<bool> ready{false};  // Set once, after ticker is written
+        char ticker[COMMAND_TICKER_SIZE] = {};
+        std::atomic<std::uint32_t> version{0};  // Odd while the fetch thread is updating the price
+        std::atomic<double> close{0};
+        std::atomic<std::int64_t> barTime{0};
+        std::atomic<std::int64_t> fetchedAt{0};
+    };
+
+    // One request in flight
+    struct Transfer {
+        CURL* handle = nullptr;
+        std::size_t slot = 0;
+        std::string body;
+        bool active = false;  // Added to the multi handle
+    };
+
+    // Where ticker lives, or the empty slot it would take (linear probing; slots are never removed)
+    std::size_t probe(std::string_view ticker) const {
+        std::size_t index = std::hash<std::string_view>{}(ticker) % CAPACITY;
+        while (slots_[index].ready.load(std::memory_order_acquire) && ticker != slots_[index].ticker) {
+            index = (index + 1) % CAPACITY;
+        }
+        return index;
+    }
+
+    void publish(Slot& slot, const ReferencePrice& price) {
+        std::uint32_t version = slot.version.load(std::memory_order_relaxed);
+        slot.version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.close.store(price.close, std::memory_order_relaxed);
+        slot.barTime.store(price.barTime, std::memory_order_relaxed);
+        slot.fetchedAt.store(price.fetchedAt, std::memory_order_relaxed);
+        slot.version.store(version + 2, std::memory_order_release);
+    }
+
+    // The fetch thread: start requests for symbols that are due, then wait on the multi handle
+    // until a request finishes, a symbol is added, the next one falls due or stop() is called
+    void run() {
+        using Clock = std::chrono::steady_clock;
+        struct Scheduled {
+            std::size_t slot;
+            Clock::time_point due;
+            bool inFlight;
+        };
+        std::vector<Scheduled> schedule;
+        std::vector<std::unique_ptr<Transfer>> transfers;  // Every transfer ever made; reused once done
+        std::vector<Transfer*> idle;
+        std::size_t running = 0;
+
+        while (!stopping_) {
+            {
+                std::lock_guard<std::mutex> lock(watchMutex_);
+                for (std::size_t slot : added_) schedule.push_back({slot, Clock::now(), false});
+                added_.clear();
+            }
+
+            auto now = Clock::now();
+            for (Scheduled& entry : schedule) {
+                if (running >= policy_.maxConcurrent) break;
+                if (entry.inFlight || entry.due > now) continue;
+                if (idle.empty()) {
+                    auto transfer = std::make_unique<Transfer>();
+                    transfer->handle = curl_easy_init();
+                    if (!transfer->handle) break;
+                    idle.push_back(transfer.get());
+                    transfers.push_back(std::move(transfer));
+                }
+                Transfer* transfer = idle.back();
+                idle.pop_back();
+                transfer->slot = entry.slot;
+                transfer->body.clear();
+                configure(*transfer);
+                curl_multi_add_handle(multi_, transfer->handle);
+                transfer->active = true;
+                entry.inFlight = true;
+                ++running;
+            }
+
+            int stillRunning = 0;
+            curl_multi_perform(multi_, &stillRunning);
+            int queued = 0;
+            while (CURLMsg* message = curl_multi_info_read(multi_, &queued)) {
+                if (message->msg != CURLMSG_DONE) continue;
+                Transfer* transfer = nullptr;
+                curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &transfer);
+                finish(*transfer, message->data.result);
+                curl_multi_remove_handle(multi_, transfer->handle);
+                transfer->active = false;
+                for (Scheduled& entry : schedule) {
+                    if (entry.slot == transfer->slot) {
+                        entry.inFlight = false;
+                        entry.due = Clock::now() + policy_.refreshInterval;
+                    }
+                }
+                idle.push_back(transfer);
+                --running;
+            }
+
+            // Sleep until a transfer makes progress or the next symbol that could start falls due
+            now = Clock::now();
+            auto wake = now + std::chrono::seconds(1);
+            if (running < policy_.maxConcurrent) {
+                for (const Scheduled& entry : schedule) {
+                    if (!entry.inFlight && entry.due < wake) wake = entry.due;
+                }
+            }
+            auto timeoutMs = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+            if (timeoutMs > 0) {
+                curl_multi_poll(multi_, nullptr, 0, static_cast<int>(timeoutMs), nullptr);
+            }
+        }
+
+        // Abandon whatever is still in flight
+        for (auto& transfer : transfers) {
+            if (transfer->active) {
+                curl_multi_remove_handle(multi_, transfer->handle);
+            }
+            curl_easy_cleanup(transfer->handle);
+        }
+    }
+
+    void configure(Transfer& transfer) {
+        std::string url = baseUrl_ + "/query?function=TIME_SERIES_INTRADAY&symbol=" + slots_[transfer.slot].ticker
+                          + "&interval=5min&apikey=" + apiKey_;
+        curl_easy_setopt(transfer.handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(transfer.handle, CURLOPT_WRITEFUNCTION, appendBody);
+        curl_easy_setopt(transfer.handle, CURLOPT_WRITEDATA, &transfer.body);
+        curl_easy_setopt(transfer.handle, CURLOPT_PRIVATE, &transfer);
+        curl_easy_setopt(transfer.handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(transfer.handle, CURLOPT_TIMEOUT, policy_.timeoutSeconds);
+    }
+
+    void finish(Transfer& transfer, CURLcode result) {
+        Slot& slot = slots_[transfer.slot];
+        ReferencePrice price;
+        std::string error;
+        if (result != CURLE_OK) {
+            error = curl_easy_strerror(result);
+        } else if (parseIntradayClose(transfer.body, price, error)) {
+            price.fetchedAt = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            publish(slot, price);
+            fetches_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // A failed refresh keeps the last good price; the symbol is tried again next interval
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        lastError_ = std::string(slot.ticker) + ": " + error;
+    }
+
+    static size_t appendBody(void* contents, size_t size, size_t nmemb, void* userp) {
+        static_cast<std::string*>(userp)->append(static_cast<char*>(contents), size * nmemb);
+        return size * nmemb;
+    }
+
+    std::string baseUrl_;
+    std::string apiKey_;
+    PriceServicePolicy policy_;
+    std::vector<Slot> slots_;
+    std::mutex watchMutex_;  // Serializes watch(); readers never take it
+    std::size_t watched_ = 0;
+    std::vector<std::size_t> added_;  // Slots added since the fetch thread last looked
+    CURLM* multi_ = nullptr;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+    std::atomic<std::size_t> fetches_{0};
+    std::atomic<std::size_t> failures_{0};
+    mutable std::mutex errorMutex_;
+    std::string lastError_;
+};
+
+#endif // PRICESERVICE_H
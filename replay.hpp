@@ -0,0 +1,305 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "command.hpp"
+#include "numparse.hpp"
+#include "sequencer.hpp"
+
+// Order files for batch replay come in two formats.
+//
+// CSV, one record per line ('#' comments and blank lines are skipped):
+//   add,buy|sell,TICKER,PRICE,QUANTITY
+//   cancel,ORDER
+//   modify,ORDER,PRICE,QUANTITY
+// PRICE and QUANTITY must be above zero.
+//
+// Binary: the magic "OBORDERS", a uint32 version, then fixed 40-byte ReplayRecords in host
+// byte order. --convert-orders writes one from a CSV file.
+//
+// ORDER refers to an add in the same file by its position among the file's adds, from 1.
+// Replay maps it to the order ID that add is given, so a file replays the same way
+// whatever history the book already holds.
+
+constexpr char REPLAY_MAGIC[8] = {'O', 'B', 'O', 'R', 'D', 'E', 'R', 'S'};
+constexpr std::uint32_t REPLAY_VERSION = 1;
+
+// One record of a binary order file
+struct ReplayRecord {
+    std::uint8_t type;      // CommandType: ADD, CANCEL or MODIFY
+    std::uint8_t side;      // Side, for adds
+    std::uint16_t reserved;
+    std::int32_t order;     // Add number within the file, for cancels and modifies
+    double price;
+    double quantity;
+    char ticker[COMMAND_TICKER_SIZE];
+};
+static_assert(sizeof(ReplayRecord) == 40, "ReplayRecord layout is part of the file format");
+
+// Parse one CSV line into a command; orderId holds the file's add number.
+// Fields are views into the line and numbers are parsed in place, so nothing is allocated.
+inline bool parseReplayLine(std::string_view line, Command& command) {
+    std::string_view fields[6];
+    std::size_t count = 0;
+    while (count < std::size(fields)) {
+        std::size_t comma = line.find(',');
+        fields[count++] = line.substr(0, comma);
+        if (comma == std::string_view::npos) break;
+        line.remove_prefix(comma + 1);
+    }
+    // Prices and quantities must be above zero
+    auto number = [](std::string_view text, double& value) {
+        Decimal decimal;
+        if (!parseDecimal(text, decimal) || decimal.mantissa <= 0) return false;
+        value = toDouble(decimal);
+        return true;
+    };
+    int order = 0;
+    double price = 0, quantity = 0;
+    std::string_view kind = fields[0];
+    if (kind == "add" && count == 5 && (fields[1] == "buy" || fields[1] == "sell")
+        && number(fields[3], price) && number(fields[4], quantity)) {
+        return makeAddCommand(fields[1] == "buy" ? Side::BUY : Side::SELL, price, quantity, fields[2], command);
+    }
+    if (kind == "cancel" && count == 2 && parseInteger(fields[1], order)) {
+        command = makeCancelCommand(order);
+        return true;
+    }
+    if (kind == "modify" && count == 4 && parseInteger(fields[1], order) && number(fields[2], price)
+        && number(fields[3], quantity)) {
+        command = makeModifyCommand(order, price, quantity);
+        return true;
+    }
+    return false;
+}
+
+// Read an order file, CSV or binary (told apart by the magic), into commands.
+// On failure error says which record is wrong.
+inline bool loadReplayFile(const std::string& path, std::vector<Command>& commands, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    char magic[sizeof(REPLAY_MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    if (in.gcount() == sizeof(magic) && std::memcmp(magic, REPLAY_MAGIC, sizeof(magic)) == 0) {
+        std::uint32_t version = 0;
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (version != REPLAY_VERSION) {
+            error = path + ": unsupported order file version " + std::to_string(version);
+            return false;
+        }
+        ReplayRecord record;
+        while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+            Command command{};
+            command.type = static_cast<CommandType>(record.type);
+            command.side = static_cast<Side>(record.side);
+            command.orderId = record.order;
+            command.price = record.price;
+            command.quantity = record.quantity;
+            std::memcpy(command.ticker, record.ticker, COMMAND_TICKER_SIZE);
+            command.ticker[COMMAND_TICKER_SIZE - 1] = '\0';
+            // Binary records skip the text parser, so their fields are checked here instead
+            const char* problem = nullptr;
+            if (command.type != CommandType::ADD && command.type != CommandType::CANCEL
+                && command.type != CommandType::MODIFY) {
+                problem = "has an unknown type";
+            } else if (record.side > static_cast<std::uint8_t>(Side::SELL)) {
+                problem = "has an unknown side";
+            } else if (command.type != CommandType::CANCEL
+                       && (!std::isfinite(record.price) || !std::isfinite(record.quantity))) {
+                problem = "has a price or quantity that is not a finite number";
+            } else if (command.type != CommandType::CANCEL && (record.price <= 0 || record.quantity <= 0)) {
+                problem = "has a price or quantity that is not positive";
+            }
+            if (problem) {
+                error = path + ": record " + std::to_string(commands.size() + 1) + " " + problem;
+                return false;
+            }
+            commands.push_back(command);
+        }
+        if (in.gcount() != 0) {
+            error = path + ": truncated record at the end";
+            return false;
+        }
+        return true;
+    }
+
+    in.clear();
+    in.seekg(0);
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        Command command;
+        if (!parseReplayLine(line, command)) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected add,buy|sell,TICKER,PRICE,QUANTITY, "
+                    "cancel,ORDER or modify,ORDER,PRICE,QUANTITY, with PRICE and QUANTITY above zero";
+            return false;
+        }
+        commands.push_back(command);
+    }
+    return true;
+}
+
+// Write commands as a binary order file
+inline bool writeReplayFile(const std::string& path, const std::vector<Command>& commands) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    out.write(reinterpret_cast<const char*>(&REPLAY_VERSION), sizeof(REPLAY_VERSION));
+    for (const Command& command : commands) {
+        ReplayRecord record{};
+        record.type = static_cast<std::uint8_t>(command.type);
+        record.side = static_cast<std::uint8_t>(command.side);
+        record.order = command.orderId;
+        record.price = command.price;
+        record.quantity = command.quantity;
+        std::memcpy(record.ticker, command.ticker, COMMAND_TICKER_SIZE);
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    if (!out.flush()) {
+        std::cerr << "Cannot write order file " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Time from submit to the end of execution for every replayed command.
+// The ingress thread stamps a command's slot before submitting it and the shard thread
+// stamps it again after executing it; the shard ring orders the two writes.
+class ReplayLatency {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void begin(std::uint64_t firstSequence, std::size_t commands) {
+        firstSequence_ = firstSequence;
+        submitted_.assign(commands, Clock::time_point{});
+        executed_.assign(commands, Clock::time_point{});
+        active_.store(true, std::memory_order_release);
+    }
+
+    void end() {
+        active_.store(false, std::memory_order_release);
+    }
+
+    // Called on the ingress thread just before the command with this sequence number is submitted
+    void submitting(std::uint64_t sequence) {
+        submitted_[sequence - firstSequence_] = Clock::now();
+    }
+
+    // Called on the shard thread once the command has executed; a no-op outside a replay
+    void executed(std::uint64_t sequence) {
+        if (!active_.load(std::memory_order_acquire)) return;
+        std::size_t index = sequence - firstSequence_;
+        if (sequence >= firstSequence_ && index < executed_.size()) {
+            executed_[index] = Clock::now();
+        }
+    }
+
+    // Latencies, in ns, of the first count commands, sorted
+    [[nodiscard]] std::vector<double> sorted(std::size_t count) const {
+        std::vector<double> latencies;
+        latencies.reserve(count);
+        for (std::size_t i = 0; i < count && i < executed_.size(); ++i) {
+            latencies.push_back(std::chrono::duration<double, std::nano>(executed_[i] - submitted_[i]).count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        return latencies;
+    }
+
+private:
+    std::atomic<bool> active_{false};
+    std::uint64_t firstSequence_ = 0;
+    std::vector<Clock::time_point> submitted_;
+    std::vector<Clock::time_point> executed_;
+};
+
+// What a replay did
+struct ReplayResult {
+    std::size_t submitted = 0;
+    std::size_t refused = 0;     // Adds the accept filter turned down
+    std::size_t unroutable = 0;  // Cancels and modifies of unknown or refused orders
+    double seconds = 0;
+    std::vector<double> latencies;  // ns, sorted
+};
+
+// Submit commands through the sequencer as fast as it accepts them, then wait for every
+// shard to finish. Adds that accept turns down are skipped. Cancel and modify order
+// numbers are mapped to the IDs their adds were given.
+template <typename Accept>
+ReplayResult replayCommands(Sequencer& sequencer, std::vector<Command>& commands, ReplayLatency& latency,
+                            Accept&& accept) {
+    ReplayResult result;
+    std::vector<int> addIds;  // Order ID given to each add in the file, 0 if refused
+    int nextOrderId = sequencer.nextOrderId();
+    std::uint64_t nextSequence = sequencer.sequenced() + 1;
+    latency.begin(nextSequence, commands.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (Command& command : commands) {
+        if (command.type == CommandType::ADD) {
+            if (!accept(command)) {
+                addIds.push_back(0);
+                ++result.refused;
+                continue;
+            }
+            addIds.push_back(nextOrderId);
+        } else {
+            std::size_t add = static_cast<std::size_t>(command.orderId);
+            command.orderId = add >= 1 && add <= addIds.size() ? addIds[add - 1] : 0;
+        }
+        latency.submitting(nextSequence);
+        if (sequencer.submit(command) == 0) {
+            ++result.unroutable;
+            continue;
+        }
+        if (command.type == CommandType::ADD) {
+            ++nextOrderId;
+        }
+        ++nextSequence;
+        ++result.submitted;
+    }
+    sequencer.runExclusive([] {});
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    latency.end();
+
+    result.latencies = latency.sorted(result.submitted);
+    return result;
+}
+
+inline void printReplayResult(const ReplayResult& result, double loadSeconds) {
+    auto percentile = [&result](double p) {
+        if (result.latencies.empty()) return 0.0;
+        std::size_t index = static_cast<std::size_t>(p / 100.0 * static_cast<double>(result.latencies.size() - 1));
+        return result.latencies[index] / 1000.0;
+    };
+    std::cout << std::fixed << std::setprecision(1)
+              << "Replayed " << result.submitted << " commands in " << result.seconds * 1000 << " ms ("
+              << std::setprecision(0) << result.submitted / std::max(result.seconds, 1e-9) << " commands/s; file read in "
+              << std::setprecision(1) << loadSeconds * 1000 << " ms).\n";
+    if (result.refused > 0) {
+        std::cout << "Refused " << result.refused << " adds for inactive or unknown symbols, or off tick or lot size.\n";
+    }
+    if (result.unroutable > 0) {
+        std::cout << "Skipped " << result.unroutable << " cancels or modifies of unknown or refused orders.\n";
+    }
+    std::cout << "Latency, submit to executed (us): p50 " << percentile(50) << ", p90 " << percentile(90)
+              << ", p99 " << percentile(99) << ", p99.9 " << percentile(99.9) << ", max " << percentile(100) << "\n"
+              << std::defaultfloat;
+}
+
+#endif // REPLAY_H
@@ -0,0 +1,249 @@
+#ifndef REPORTING_H
+#define REPORTING_H
+
+#include <fstream>
+#include <map>
+#include <iomanip>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+#include "historyquery.hpp"
+#include "archive.hpp"
+
+// Reports over order history. Each one runs on the reader's own connection inside a single
+// read snapshot, so its figures agree with each other even while the writer keeps committing.
+
+// Orders, live orders, trades, traded volume and VWAP per ticker
+inline void printHistorySummary(HistoryReader& reader) {
+    sqlite3* db = reader.handle();
+    if (!db) {
+        std::cout << "Order history is not available.\n";
+        return;
+    }
+    ReadSnapshot snapshot(db);
+
+    const char* sql =
+        "SELECT o.TICKER, o.ORDERS, o.LIVE, COALESCE(t.TRADES, 0), COALESCE(t.VOLUME, 0), COALESCE(t.NOTIONAL, 0) "
+        "FROM (SELECT TICKER, COUNT(*) AS ORDERS, SUM(REMAINING > 0) AS LIVE FROM ORDERS GROUP BY TICKER) o "
+        "LEFT JOIN (SELECT TICKER, COUNT(*) AS TRADES, SUM(QUANTITY) AS VOLUME, SUM(PRICE * QUANTITY) AS NOTIONAL"
+        " FROM TRADES GROUP BY TICKER) t ON t.TICKER = o.TICKER "
+        "ORDER BY o.TICKER;";
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing history summary: " << sqlite3_errmsg(db) << std::endl;
+        return;
+    }
+
+    std::cout << std::left
+              << std::setw(12) << "TICKER"
+              << std::setw(10) << "ORDERS"
+              << std::setw(10) << "LIVE"
+              << std::setw(10) << "TRADES"
+              << std::setw(14) << "VOLUME"
+              << std::setw(12) << "VWAP" << std::endl;
+    std::cout << std::string(68, '-') << std::endl;
+
+    bool hasRows = false;
+    while (sqlite3_step(statement) == SQLITE_ROW) {
+        hasRows = true;
+        const unsigned char* ticker = sqlite3_column_text(statement, 0);
+        double volume = sqlite3_column_double(statement, 4);
+        double notional = sqlite3_column_double(statement, 5);
+        std::cout << std::left
+                  << std::setw(12) << (ticker ? reinterpret_cast<const char*>(ticker) : "")
+                  << std::setw(10) << sqlite3_column_int64(statement, 1)
+                  << std::setw(10) << sqlite3_column_int64(statement, 2)
+                  << std::setw(10) << sqlite3_column_int64(statement, 3)
+                  << std::setw(14) << volume
+                  << std::setw(12);
+        if (volume > 0) {
+            std::cout << notional / volume;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << std::endl;
+    }
+    sqlite3_finalize(statement);
+
+    if (!hasRows) {
+        std::cout << "No orders stored yet.\n";
+    }
+}
+
+// Write every row of a query to a CSV file with a header line; returns the number of rows
+inline long long exportQueryCsv(sqlite3* db, const char* sql, const std::string& path) {
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing export: " << sqlite3_errmsg(db) << std::endl;
+        return -1;
+    }
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        std::cerr << "Cannot write " << path << std::endl;
+        sqlite3_finalize(statement);
+        return -1;
+    }
+
+    int columns = sqlite3_column_count(statement);
+    for (int c = 0; c < columns; ++c) {
+        out << (c ? "," : "") << sqlite3_column_name(statement, c);
+    }
+    out << "\n";
+
+    long long rows = 0;
+    while (sqlite3_step(statement) == SQLITE_ROW) {
+        for (int c = 0; c < columns; ++c) {
+            const unsigned char* value = sqlite3_column_text(statement, c);
+            out << (c ? "," : "") << (value ? reinterpret_cast<const char*>(value) : "");
+        }
+        out << "\n";
+        ++rows;
+    }
+    sqlite3_finalize(statement);
+    return rows;
+}
+
+// Export ORDERS and TRADES to <prefix>_orders.csv and <prefix>_trades.csv from one snapshot
+inline void exportHistory(HistoryReader& reader, const std::string& prefix) {
+    sqlite3* db = reader.handle();
+    if (!db) {
+        std::cout << "Order history is not available.\n";
+        return;
+    }
+    ReadSnapshot snapshot(db);
+
+    long long orders = exportQueryCsv(db,
+        "SELECT ORDER_ID, TICKER, PRICE, QUANTITY, REMAINING, SIDE, CREATED_AT FROM ORDERS ORDER BY ORDER_ID;",
+        prefix + "_orders.csv");
+    long long trades = exportQueryCsv(db,
+        "SELECT TRADE_ID, TICKER, BUY_ORDER_ID, SELL_ORDER_ID, PRICE, QUANTITY FROM TRADES ORDER BY TRADE_ID;",
+        prefix + "_trades.csv");
+    if (orders >= 0 && trades >= 0) {
+        std::cout << "Exported " << orders << " orders to " << prefix << "_orders.csv and "
+                  << trades << " trades to " << prefix << "_trades.csv.\n";
+    }
+}
+
+// Write the ORDERS rows returned by sql (columns in HistoryRow order) to a columnar archive;
+// returns the number of rows, or -1 if nothing was written
+inline long long archiveQuery(sqlite3* db, const char* sql, const std::string& path) {
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing archive query: " << sqlite3_errmsg(db) << std::endl;
+        return -1;
+    }
+    ArchiveWriter writer;
+    if (!writer.open(path)) {
+        sqlite3_finalize(statement);
+        return -1;
+    }
+    while (sqlite3_step(statement) == SQLITE_ROW) {
+        const unsigned char* ticker = sqlite3_column_text(statement, 1);
+        writer.add({
+            sqlite3_column_int(statement, 0),
+            ticker ? reinterpret_cast<const char*>(ticker) : "",
+            sqlite3_column_double(statement, 2),
+            sqlite3_column_double(statement, 3),
+            sqlite3_column_double(statement, 4),
+            sqlite3_column_int(statement, 5) == 0 ? Side::BUY : Side::SELL,
+            sqlite3_column_int64(statement, 6)});
+    }
+    sqlite3_finalize(statement);
+    return writer.finish() ? static_cast<long long>(writer.rows()) : -1;
+}
+
+// Archive every order from one snapshot, sorted by ticker so per-ticker scans touch few blocks
+inline void archiveHistory(HistoryReader& reader, const std::string& path) {
+    sqlite3* db = reader.handle();
+    if (!db) {
+        std::cout << "Order history is not available.\n";
+        return;
+    }
+    ReadSnapshot snapshot(db);
+    long long orders = archiveQuery(db,
+        "SELECT ORDER_ID, TICKER, PRICE, QUANTITY, REMAINING, SIDE, CREATED_AT FROM ORDERS ORDER BY TICKER, ORDER_ID;",
+        path);
+    if (orders >= 0) {
+        std::cout << "Archived " << orders << " orders to " << path << ".\n";
+    }
+}
+
+// Per-ticker figures read from an archive
+struct ArchiveTickerTotals {
+    long long orders = 0;
+    long long live = 0;
+    double quantity = 0;
+    double priceSum = 0;
+};
+
+// Orders, live orders, quantity and price sum per ticker from an archive. Without filters only
+// the ticker, price, quantity and remaining columns are decoded; with filters the block index
+// skips blocks that cannot match. Returns false if the archive is corrupt.
+inline bool summarizeArchive(const ArchiveReader& archive, const HistoryQuery& query,
+                             std::map<std::string, ArchiveTickerTotals>& totals) {
+    using Totals = ArchiveTickerTotals;
+    bool ok = true;
+
+    bool filtered = !query.ticker.empty() || query.side || query.minOrderId || query.maxOrderId
+                    || query.fromTime || query.toTime;
+    if (filtered) {
+        ok = archive.scan(query, [&totals](const HistoryRow& row) {
+            Totals& t = totals[row.ticker];
+            ++t.orders;
+            t.live += row.remaining > 0;
+            t.quantity += row.quantity;
+            t.priceSum += row.price;
+        });
+    } else {
+        std::vector<Totals> byId(archive.tickers().size());
+        std::vector<std::int64_t> tickers;
+        std::vector<double> prices, quantities, remaining;
+        for (std::size_t b = 0; ok && b < archive.blocks().size(); ++b) {
+            ok = archive.readIntegers(b, ArchiveColumn::TICKER, tickers) && archive.tickersInDictionary(tickers)
+                 && archive.readDoubles(b, ArchiveColumn::PRICE, prices)
+                 && archive.readDoubles(b, ArchiveColumn::QUANTITY, quantities)
+                 && archive.readDoubles(b, ArchiveColumn::REMAINING, remaining);
+            for (std::size_t i = 0; ok && i < tickers.size(); ++i) {
+                Totals& t = byId[static_cast<std::size_t>(tickers[i])];
+                ++t.orders;
+                t.live += remaining[i] > 0;
+                t.quantity += quantities[i];
+                t.priceSum += prices[i];
+            }
+        }
+        for (std::size_t id = 0; id < byId.size(); ++id) {
+            if (byId[id].orders) totals[archive.tickers()[id]] = byId[id];
+        }
+    }
+    return ok;
+}
+
+// Print summarizeArchive as a table
+inline void printArchiveSummary(const ArchiveReader& archive, const HistoryQuery& query) {
+    std::map<std::string, ArchiveTickerTotals> totals;
+    if (!summarizeArchive(archive, query, totals)) {
+        std::cout << "Archive is corrupt.\n";
+        return;
+    }
+
+    std::cout << std::left
+              << std::setw(12) << "TICKER"
+              << std::setw(12) << "ORDERS"
+              << std::setw(10) << "LIVE"
+              << std::setw(16) << "QUANTITY"
+              << std::setw(12) << "AVG PRICE" << std::endl;
+    std::cout << std::string(62, '-') << std::endl;
+    for (const auto& [ticker, t] : totals) {
+        std::cout << std::left
+                  << std::setw(12) << ticker
+                  << std::setw(12) << t.orders
+                  << std::setw(10) << t.live
+                  << std::setw(16) << t.quantity
+                  << std::setw(12) << t.priceSum / static_cast<double>(t.orders) << std::endl;
+    }
+    if (totals.empty()) {
+        std::cout << "No matching orders.\n";
+    }
+}
+
+#endif // REPORTING_H
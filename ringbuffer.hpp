@@ -0,0 +1,193 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <type_traits>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+// Size of a cache line, used to keep producer and consumer state on separate lines
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Hint to the CPU that we are in a spin loop
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(_M_X64)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// How a consumer waits when its ring is empty
+enum class WaitStrategy {
+    BUSY_SPIN,  // Never leave the core; lowest latency, burns a full CPU
+    BACKOFF     // Spin briefly, then yield, then sleep; suitable for interactive use
+};
+
+// Bounded multi-producer/single-consumer ring of fixed-size records.
+// Every slot carries a sequence number: producers claim a position with one CAS
+// and publish by bumping the slot sequence, the consumer reads without any lock.
+template <typename T, std::size_t Capacity>
+class MPSCRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Ring records must be trivially copyable");
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+public:
+    MPSCRingBuffer() : slots_(new Slot[Capacity]) {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCRingBuffer(const MPSCRingBuffer&) = delete;
+    MPSCRingBuffer& operator=(const MPSCRingBuffer&) = delete;
+
+    // Try to append a record; returns false if the ring is full
+    bool tryPush(const T& value) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots_[pos & (Capacity - 1)];
+            std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // Consumer has not freed this slot yet
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = value;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Append a record, spinning while the ring is full (back-pressure on producers).
+    // Yields after a short spin so a descheduled consumer can make progress.
+    void push(const T& value) {
+        for (unsigned spins = 0; !tryPush(value); ++spins) {
+            if (spins < 64) {
+                cpuRelax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Take the oldest record; must only be called from the single consumer thread
+    bool tryPop(T& out) {
+        Slot& slot = slots_[tail_ & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+            return false;
+        }
+        out = slot.value;
+        slot.sequence.store(tail_ + Capacity, std::memory_order_release);
+        ++tail_;
+        return true;
+    }
+
+    // Consumer-side check for pending records
+    [[nodiscard]] bool empty() const {
+        const Slot& slot = slots_[tail_ & (Capacity - 1)];
+        return slot.sequence.load(std::memory_order_acquire) != tail_ + 1;
+    }
+
+    // Total number of positions ever claimed by producers
+    [[nodiscard]] std::size_t claimed() const {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{0};  // Next position claimed by producers
+    alignas(CACHE_LINE_SIZE) std::size_t tail_ = 0;              // Next position read by the consumer
+    std::unique_ptr<Slot[]> slots_;
+};
+
+// A ring buffer with a dedicated consumer thread that hands every record to a handler.
+// Records pushed before destruction are always drained before the thread exits.
+template <typename T, std::size_t Capacity>
+class RingWorker {
+public:
+    using Handler = std::function<void(T&)>;
+
+    RingWorker(Handler handler, WaitStrategy strategy = WaitStrategy::BACKOFF)
+        : handler_(std::move(handler)), strategy_(strategy) {
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~RingWorker() {
+        stop_.store(true, std::memory_order_release);
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    RingWorker(const RingWorker&) = delete;
+    RingWorker& operator=(const RingWorker&) = delete;
+
+    // Publish a record to the consumer; blocks (spinning) only when the ring is full
+    void submit(const T& record) {
+        ring_.push(record);
+    }
+
+private:
+    void run() {
+        T record;
+        unsigned idleRounds = 0;
+        while (true) {
+            if (ring_.tryPop(record)) {
+                idleRounds = 0;
+                try {
+                    handler_(record);
+                } catch (const std::exception& e) {
+                    std::cerr << "Task threw exception: " << e.what() << std::endl;
+                } catch (...) {
+                    std::cerr << "Task threw an unknown exception" << std::endl;
+                }
+                continue;
+            }
+
+            if (stop_.load(std::memory_order_acquire) && ring_.empty()) {
+                return;
+            }
+            idle(idleRounds++);
+        }
+    }
+
+    void idle(unsigned rounds) const {
+        if (strategy_ == WaitStrategy::BUSY_SPIN || rounds < 128) {
+            cpuRelax();
+        } else if (rounds < 1024) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    MPSCRingBuffer<T, Capacity> ring_;
+    Handler handler_;
+    WaitStrategy strategy_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,151 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "command.hpp"
+#include "ringbuffer.hpp"
+
+constexpr std::size_t SHARD_RING_CAPACITY = 4096;
+
+// Stamps every command with a global sequence number at ingress and routes it to a
+// matching shard chosen by symbol. Each shard is a single-consumer ring, so commands
+// for one symbol execute in exactly the order they were sequenced, while different
+// symbols run in parallel on different shards.
+class Sequencer {
+public:
+    using Handler = std::function<void(Command&)>;
+
+    // Each shard is a ring and a thread, and order routes store shard numbers in 16 bits
+    static constexpr std::size_t MAX_SHARDS = 256;
+
+    Sequencer(std::size_t shardCount, int firstOrderId, const Handler& handler,
+              WaitStrategy strategy = WaitStrategy::BACKOFF)
+        : nextOrderId_(firstOrderId) {
+        shardCount = std::clamp<std::size_t>(shardCount, 1, MAX_SHARDS);
+        auto shardHandler = [this, handler](Command& command) {
+            if (command.type == CommandType::BARRIER) {
+                waitAtBarrier();
+            } else {
+                handler(command);
+            }
+        };
+        for (std::size_t i = 0; i < shardCount; ++i) {
+            shards_.push_back(std::make_unique<RingWorker<Command, SHARD_RING_CAPACITY>>(shardHandler, strategy));
+        }
+    }
+
+    // Stamp a command and hand it to its symbol's shard. ADD commands also receive
+    // their order ID here, so IDs follow ingress order rather than execution order.
+    // Returns the sequence number, or 0 if the command could not be routed.
+    std::uint64_t submit(Command command) {
+        std::lock_guard<std::mutex> lock(ingressMutex_);
+
+        std::size_t shard;
+        if (command.type == CommandType::ADD || command.type == CommandType::QUERY) {
+            shard = shardForTicker(command.ticker);
+        } else if (command.orderId > 0 && static_cast<std::size_t>(command.orderId) < orderShards_.size()
+                   && orderShards_[command.orderId] != UNKNOWN_SHARD) {
+            shard = orderShards_[command.orderId];
+        } else {
+            return 0;
+        }
+
+        if (command.type == CommandType::ADD) {
+            command.orderId = nextOrderId_.fetch_add(1, std::memory_order_relaxed);
+            recordRoute(command.orderId, shard);
+        }
+        command.sequence = nextSequence_++;
+
+        // Pushing while still holding the ingress lock keeps ring order equal to sequence order
+        shards_[shard]->submit(command);
+        return command.sequence;
+    }
+
+    // Make an order that already rests in the book (e.g. loaded at startup) routable
+    void registerOrder(int orderId, const std::string& ticker) {
+        std::lock_guard<std::mutex> lock(ingressMutex_);
+        recordRoute(orderId, shardForTicker(ticker));
+    }
+
+    // Run fn while every shard is idle: all commands sequenced so far have executed and
+    // no new ones are accepted until fn returns. Used for consistent book snapshots.
+    template <typename Fn>
+    void runExclusive(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(ingressMutex_);
+        Command barrier{};
+        barrier.type = CommandType::BARRIER;
+
+        std::unique_lock<std::mutex> barrierLock(barrierMutex_);
+        arrived_ = 0;
+        for (auto& shard : shards_) {
+            shard->submit(barrier);
+        }
+        barrierCv_.wait(barrierLock, [this] { return arrived_ == shards_.size(); });
+
+        fn();
+
+        ++barrierGeneration_;
+        barrierLock.unlock();
+        barrierCv_.notify_all();
+    }
+
+    // Number of commands sequenced so far
+    [[nodiscard]] std::uint64_t sequenced() const {
+        std::lock_guard<std::mutex> lock(ingressMutex_);
+        return nextSequence_ - 1;
+    }
+
+    // Order ID the next ADD will receive. Takes no lock, so it can be read inside runExclusive,
+    // where it is exact since no command is being sequenced.
+    [[nodiscard]] int nextOrderId() const {
+        return nextOrderId_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::size_t shardCount() const { return shards_.size(); }
+
+private:
+    static constexpr std::uint16_t UNKNOWN_SHARD = 0xFFFF;
+    static_assert(MAX_SHARDS < UNKNOWN_SHARD, "shard numbers must not collide with UNKNOWN_SHARD");
+
+    std::size_t shardForTicker(std::string_view ticker) const {
+        return std::hash<std::string_view>{}(ticker) % shards_.size();
+    }
+
+    // Order IDs are dense, so a vector indexed by ID is the cheapest route table
+    void recordRoute(int orderId, std::size_t shard) {
+        if (orderId <= 0) return;
+        if (static_cast<std::size_t>(orderId) >= orderShards_.size()) {
+            orderShards_.resize(std::max<std::size_t>(orderId + 1, orderShards_.size() * 2), UNKNOWN_SHARD);
+        }
+        orderShards_[orderId] = static_cast<std::uint16_t>(shard);
+    }
+
+    // Called on a shard thread when it reaches a barrier; blocks until runExclusive is done
+    void waitAtBarrier() {
+        std::unique_lock<std::mutex> lock(barrierMutex_);
+        std::uint64_t generation = barrierGeneration_;
+        ++arrived_;
+        barrierCv_.notify_all();
+        barrierCv_.wait(lock, [this, generation] { return barrierGeneration_ != generation; });
+    }
+
+    mutable std::mutex ingressMutex_;
+    std::mutex barrierMutex_;
+    std::condition_variable barrierCv_;
+    std::size_t arrived_ = 0;
+    std::uint64_t barrierGeneration_ = 0;
+    std::uint64_t nextSequence_ = 1;
+    std::atomic<int> nextOrderId_;  // Only advanced under ingressMutex_
+    std::vector<std::uint16_t> orderShards_;
+    std::vector<std::unique_ptr<RingWorker<Command, SHARD_RING_CAPACITY>>> shards_;
+};
+
+#endif // SEQUENCER_H
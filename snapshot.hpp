@@ -0,0 +1,239 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "orderbook.hpp"
+#include "journal.hpp"
+
+// Binary snapshot of the live book.
+// Layout: magic, version, journal sequence, last order ID, symbol count, then per symbol
+// the ticker and both sides (levels best-first, orders in queue order), then a CRC32C
+// of everything before it.
+constexpr char SNAPSHOT_MAGIC[8] = {'O', 'B', 'S', 'N', 'A', 'P', '0', '1'};
+constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+// Little helpers to append/read plain values to/from a byte buffer
+class SnapshotBuffer {
+public:
+    std::string bytes;
+    std::size_t cursor = 0;
+
+    template <typename T>
+    void put(const T& value) {
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const std::string& value) {
+        put(static_cast<std::uint32_t>(value.size()));
+        bytes.append(value);
+    }
+
+    template <typename T>
+    bool get(T& value) {
+        if (cursor + sizeof(T) > bytes.size()) return false;
+        std::memcpy(&value, bytes.data() + cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    bool getString(std::string& value) {
+        std::uint32_t size;
+        if (!get(size) || cursor + size > bytes.size()) return false;
+        value.assign(bytes.data() + cursor, size);
+        cursor += size;
+        return true;
+    }
+};
+
+template <typename Levels>
+void writeSnapshotSide(SnapshotBuffer& buffer, const Levels& levels) {
+    buffer.put(static_cast<std::uint32_t>(levels.size()));
+    for (const auto& [price, level] : levels) {
+        buffer.put(price);
+        buffer.put(static_cast<std::uint32_t>(level.orders.size()));
+        for (const Order& order : level.orders) {
+            buffer.put(static_cast<std::int32_t>(order.getOrderId()));
+            buffer.put(order.getQuantity());
+        }
+    }
+}
+
+// Force a file, or a directory's entries, to stable storage
+inline bool syncPath(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    bool ok = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) ::close(fd);
+    return ok;
+}
+
+// The directory holding path, for syncing a rename into it
+inline std::string parentDirectory(const std::string& path) {
+    std::size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// Write the whole book, covering every journal event below journalSequence.
+// The book must not change while this runs (see Sequencer::runExclusive).
+// The file is written under a temporary name, synced, renamed and the rename synced, so
+// neither a crash nor a power loss leaves a torn or empty snapshot in place of the last one.
+inline bool writeSnapshot(const OrderBook& book, std::uint64_t journalSequence, const std::string& path) {
+    SnapshotBuffer buffer;
+    buffer.bytes.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    buffer.put(SNAPSHOT_VERSION);
+    buffer.put(journalSequence);
+    buffer.put(static_cast<std::int32_t>(book.lastOrderId));
+
+    {
+        std::shared_lock<std::shared_mutex> lock(book.symbolsMutex);
+        std::vector<std::string> tickers;
+        for (const auto& [ticker, side] : book.buySides) tickers.push_back(ticker);
+        for (const auto& [ticker, side] : book.sellSides) {
+            if (!book.buySides.count(ticker)) tickers.push_back(ticker);
+        }
+
+        buffer.put(static_cast<std::uint32_t>(tickers.size()));
+        for (const std::string& ticker : tickers) {
+            buffer.putString(ticker);
+            auto buyIt = book.buySides.find(ticker);
+            if (buyIt != book.buySides.end()) {
+                writeSnapshotSide(buffer, buyIt->second.bids);
+            } else {
+                buffer.put(static_cast<std::uint32_t>(0));
+            }
+            auto sellIt = book.sellSides.find(ticker);
+            if (sellIt != book.sellSides.end()) {
+                writeSnapshotSide(buffer, sellIt->second.asks);
+            } else {
+                buffer.put(static_cast<std::uint32_t>(0));
+            }
+        }
+    }
+    buffer.put(crc32c(buffer.bytes.data(), buffer.bytes.size()));
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(buffer.bytes.data(), static_cast<std::streamsize>(buffer.bytes.size()));
+        out.flush();
+        if (!out) {
+            std::cerr << "Failed to write snapshot " << tempPath << std::endl;
+            return false;
+        }
+    }
+    if (!syncPath(tempPath)) {
+        std::cerr << "Failed to sync snapshot " << tempPath << std::endl;
+        return false;
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to install snapshot " << path << std::endl;
+        return false;
+    }
+    if (!syncPath(parentDirectory(path))) {
+        std::cerr << "Failed to sync the directory of snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Load a snapshot into an empty book. On success journalSequence is the first
+// journal sequence that still has to be replayed on top of it. A snapshot older than
+// oldestJournalSequence is rejected, since the events after it are no longer available.
+// The whole body is parsed and checked before any order is rested, so a rejected
+// snapshot leaves the book untouched.
+inline bool loadSnapshot(OrderBook& book, const std::string& path, std::uint64_t oldestJournalSequence,
+                         std::uint64_t& journalSequence) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    SnapshotBuffer buffer;
+    buffer.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    std::uint32_t storedChecksum;
+    if (buffer.bytes.size() < sizeof(SNAPSHOT_MAGIC) + sizeof(storedChecksum)
+        || std::memcmp(buffer.bytes.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        std::cerr << "Snapshot " << path << " has an unknown format; ignoring it" << std::endl;
+        return false;
+    }
+    std::size_t bodySize = buffer.bytes.size() - sizeof(storedChecksum);
+    std::memcpy(&storedChecksum, buffer.bytes.data() + bodySize, sizeof(storedChecksum));
+    if (crc32c(buffer.bytes.data(), bodySize) != storedChecksum) {
+        std::cerr << "Snapshot " << path << " is corrupt; ignoring it" << std::endl;
+        return false;
+    }
+    buffer.bytes.resize(bodySize);
+    buffer.cursor = sizeof(SNAPSHOT_MAGIC);
+
+    std::uint32_t version;
+    std::int32_t lastOrderId;
+    std::uint32_t symbolCount;
+    if (!buffer.get(version) || version != SNAPSHOT_VERSION || !buffer.get(journalSequence)
+        || !buffer.get(lastOrderId) || !buffer.get(symbolCount)) {
+        return false;
+    }
+    if (journalSequence < oldestJournalSequence) {
+        std::cerr << "Snapshot " << path << " is older than the journal; ignoring it" << std::endl;
+        return false;
+    }
+
+    std::vector<Order> orders;
+    for (std::uint32_t s = 0; s < symbolCount; ++s) {
+        std::string ticker;
+        if (!buffer.getString(ticker)) return false;
+        for (Side side : {Side::BUY, Side::SELL}) {
+            std::uint32_t levelCount;
+            if (!buffer.get(levelCount)) return false;
+            for (std::uint32_t l = 0; l < levelCount; ++l) {
+                double price;
+                std::uint32_t orderCount;
+                if (!buffer.get(price) || !buffer.get(orderCount)) return false;
+                for (std::uint32_t o = 0; o < orderCount; ++o) {
+                    std::int32_t orderId;
+                    double quantity;
+                    if (!buffer.get(orderId) || !buffer.get(quantity)) return false;
+                    orders.emplace_back(orderId, price, quantity, side, ticker);
+                }
+            }
+        }
+    }
+    if (buffer.cursor != buffer.bytes.size()) {
+        std::cerr << "Snapshot " << path << " has trailing bytes; ignoring it" << std::endl;
+        return false;
+    }
+
+    for (Order& order : orders) {
+        book.restOrder(order);
+    }
+    book.lastOrderId = std::max(book.lastOrderId, static_cast<int>(lastOrderId));
+    return true;
+}
+
+// Rebuild the book from the latest snapshot plus the journal events written after it.
+// fromSequence is the first journal sequence the snapshot does not cover.
+// Returns false if there is no usable snapshot.
+inline bool recoverFromSnapshot(OrderBook& book, const EventJournal& journal, const std::string& path,
+                                std::size_t& replayed, std::uint64_t& fromSequence) {
+    fromSequence = 0;
+    if (!loadSnapshot(book, path, journal.firstSequence(), fromSequence)) {
+        return false;
+    }
+    replayed = 0;
+    journal.replay(fromSequence, [&book, &replayed](const PersistEvent& event) {
+        book.applyEvent(event);
+        ++replayed;
+    });
+    return true;
+}
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,75 @@
+#ifndef SQLITEPROFILE_H
+#define SQLITEPROFILE_H
+
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+
+// Named set of SQLite pragmas trading durability against write throughput
+struct SqliteProfile {
+    const char* name;
+    const char* journalMode;  // PRAGMA journal_mode
+    const char* synchronous;  // PRAGMA synchronous
+    long long mmapSize;       // PRAGMA mmap_size, in bytes
+    int cacheSize;            // PRAGMA cache_size; negative values are KiB
+    const char* tempStore;    // PRAGMA temp_store
+};
+
+// strict:   every commit is synced to disk before it returns
+// balanced: WAL with NORMAL sync; a power loss can drop the last commits but never corrupts
+// fast:     no syncs at all; for simulations and benchmarks where history is disposable
+inline constexpr SqliteProfile SQLITE_PROFILES[] = {
+    {"strict",   "WAL", "FULL",   0,                  -2000,   "DEFAULT"},
+    {"balanced", "WAL", "NORMAL", 256LL * 1024 * 1024, -65536,  "MEMORY"},
+    {"fast",     "WAL", "OFF",    1024LL * 1024 * 1024, -262144, "MEMORY"},
+};
+
+inline const SqliteProfile& defaultSqliteProfile() {
+    return SQLITE_PROFILES[0];
+}
+
+// Look up a profile by name; returns nullptr for unknown names
+inline const SqliteProfile* findSqliteProfile(const std::string& name) {
+    for (const SqliteProfile& profile : SQLITE_PROFILES) {
+        if (name == profile.name) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+// Apply a profile's pragmas to an open connection
+inline void applySqliteProfile(sqlite3* db, const SqliteProfile& profile) {
+    std::string sql = std::string("PRAGMA journal_mode=") + profile.journalMode + ";"
+                    + "PRAGMA synchronous=" + profile.synchronous + ";"
+                    + "PRAGMA mmap_size=" + std::to_string(profile.mmapSize) + ";"
+                    + "PRAGMA cache_size=" + std::to_string(profile.cacheSize) + ";"
+                    + "PRAGMA temp_store=" + profile.tempStore + ";";
+
+    char* messageError = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &messageError) != SQLITE_OK) {
+        std::cerr << "Error applying SQLite profile '" << profile.name << "': " << messageError << std::endl;
+        sqlite3_free(messageError);
+    }
+}
+
+// Print the profile in use, reading the journal mode back since SQLite may refuse WAL
+inline void reportSqliteProfile(sqlite3* db, const SqliteProfile& profile) {
+    std::string journalMode = "unknown";
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &statement, nullptr) == SQLITE_OK
+        && sqlite3_step(statement) == SQLITE_ROW) {
+        const unsigned char* raw = sqlite3_column_text(statement, 0);
+        journalMode = raw ? reinterpret_cast<const char*>(raw) : journalMode;
+    }
+    sqlite3_finalize(statement);
+
+    std::cout << "SQLite profile: " << profile.name
+              << " (journal_mode=" << journalMode
+              << ", synchronous=" << profile.synchronous
+              << ", mmap_size=" << profile.mmapSize
+              << ", cache_size=" << profile.cacheSize
+              << ", temp_store=" << profile.tempStore << ")\n";
+}
+
+#endif // SQLITEPROFILE_H
@@ -0,0 +1,381 @@
+#ifndef SQLITESTORE_H
+#define SQLITESTORE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include "orderbook.hpp"
+#include "storage.hpp"
+#include "statementcache.hpp"
+#include "sqliteprofile.hpp"
+#include "parallelload.hpp"
+
+// Order history in a SQLite file: ORDERS, TRADES and META (the stored journal watermark).
+// Every statement is prepared once in open() and reused.
+class SqliteStore : public StorageBackend {
+public:
+    sqlite3 *DB = nullptr;
+    std::string dbPath;                         // File the DB was opened from
+    const SqliteProfile* dbProfile = nullptr;  // Pragmas applied when the DB was opened
+    std::size_t loadThreads = 1;               // Connections used by loadLiveOrders
+
+    mutable std::mutex dbMutex;  // Serializes statements on the shared DB handle
+
+    // Statements prepared once in open and reused for every execution
+    CachedStatement insertOrderStatement;
+    CachedStatement insertTradeStatement;
+    CachedStatement deleteOrderStatement;
+    CachedStatement updateOrderStatement;
+    CachedStatement updateJournalSequenceStatement;
+    CachedStatement applyFillsStatement;
+    mutable CachedStatement selectLiveOrdersStatement;
+
+    ~SqliteStore() override {
+        for (CachedStatement* cached : {&insertOrderStatement, &insertTradeStatement, &deleteOrderStatement,
+                                        &updateOrderStatement, &updateJournalSequenceStatement,
+                                        &applyFillsStatement, &selectLiveOrdersStatement}) {
+            cached->finalize();
+        }
+        sqlite3_close(DB);
+    }
+
+    [[nodiscard]] const char* name() const override { return "sqlite"; }
+
+    bool open(const std::string& path = "orderhistory.db",
+              const SqliteProfile& profile = defaultSqliteProfile()) {
+        int exit = sqlite3_open(path.c_str(), &DB);
+        dbPath = path;
+        // Lets compaction hand freed pages back a few at a time (see HistoryCompactor). It only
+        // takes effect on a new database, so it must come before WAL mode and the tables.
+        sqlite3_exec(DB, "PRAGMA auto_vacuum=INCREMENTAL;", nullptr, nullptr, nullptr);
+        applySqliteProfile(DB, profile);
+        dbProfile = &profile;
+
+        // Create the table only if it doesn't already exist.
+        // QUANTITY is the size as placed (or last modified); REMAINING is what is still open
+        // after the fills in TRADES up to FILLED_THROUGH. CREATED_AT is milliseconds since the
+        // Unix epoch when the order was first recorded.
+        std::string sql = "CREATE TABLE IF NOT EXISTS ORDERS("
+                          "ORDER_ID INT PRIMARY KEY NOT NULL,"
+                          "TICKER TEXT NOT NULL,"
+                          "PRICE REAL NOT NULL,"
+                          "QUANTITY REAL NOT NULL,"
+                          "SIDE INT NOT NULL,"
+                          "REMAINING REAL NOT NULL DEFAULT 0,"
+                          "FILLED_THROUGH INT NOT NULL DEFAULT 0,"
+                          "CREATED_AT INT NOT NULL DEFAULT 0);";
+
+        sql += "CREATE TABLE IF NOT EXISTS TRADES("
+               "TRADE_ID INTEGER PRIMARY KEY,"
+               "TICKER TEXT NOT NULL,"
+               "BUY_ORDER_ID INT NOT NULL,"
+               "SELL_ORDER_ID INT NOT NULL,"
+               "PRICE REAL NOT NULL,"
+               "QUANTITY REAL NOT NULL);";
+
+        // Highest journal sequence number reflected in the tables above
+        sql += "CREATE TABLE IF NOT EXISTS META("
+               "KEY TEXT PRIMARY KEY NOT NULL,"
+               "VALUE INT NOT NULL);";
+
+        char* messageError;
+        exit = sqlite3_exec(DB, sql.c_str(), NULL, 0, &messageError);
+        if (exit != SQLITE_OK) {
+            std::cerr << "Error creating table: " << messageError << std::endl;
+            sqlite3_free(messageError);
+        }
+        migrateOrdersTable();
+
+        // Fills are looked up per order when remaining quantities are brought up to date,
+        // and recovery only reads orders that are still open
+        sql = "CREATE INDEX IF NOT EXISTS TRADES_BUY_ORDER ON TRADES(BUY_ORDER_ID, TRADE_ID);"
+              "CREATE INDEX IF NOT EXISTS TRADES_SELL_ORDER ON TRADES(SELL_ORDER_ID, TRADE_ID);"
+              "CREATE INDEX IF NOT EXISTS ORDERS_LIVE ON ORDERS(ORDER_ID) WHERE REMAINING > 0;"
+              "CREATE INDEX IF NOT EXISTS ORDERS_BY_TICKER ON ORDERS(TICKER, ORDER_ID);"
+              "CREATE INDEX IF NOT EXISTS ORDERS_BY_SIDE ON ORDERS(SIDE, ORDER_ID);"
+              "CREATE INDEX IF NOT EXISTS ORDERS_BY_TIME ON ORDERS(CREATED_AT, ORDER_ID);";
+        if (sqlite3_exec(DB, sql.c_str(), nullptr, nullptr, &messageError) != SQLITE_OK) {
+            std::cerr << "Error creating indexes: " << messageError << std::endl;
+            sqlite3_free(messageError);
+        }
+
+        // A new or modified order has seen no fills yet: FILLED_THROUGH starts at its own journal
+        // sequence, or at the newest trade when written without a journal. A replayed order
+        // keeps the CREATED_AT of its first write.
+        insertOrderStatement.prepare(DB, "insertOrder",
+            "INSERT INTO ORDERS (ORDER_ID, TICKER, PRICE, QUANTITY, SIDE, REMAINING, FILLED_THROUGH, CREATED_AT) "
+            "VALUES (?1, ?2, ?3, ?4, ?5, ?4, COALESCE(NULLIF(?6, 0), (SELECT COALESCE(MAX(TRADE_ID), 0) FROM TRADES)),"
+            " CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER)) "
+            "ON CONFLICT(ORDER_ID) DO UPDATE SET TICKER = excluded.TICKER, PRICE = excluded.PRICE,"
+            " QUANTITY = excluded.QUANTITY, SIDE = excluded.SIDE, REMAINING = excluded.REMAINING,"
+            " FILLED_THROUGH = excluded.FILLED_THROUGH;");
+        insertTradeStatement.prepare(DB, "insertTrade",
+            "INSERT OR REPLACE INTO TRADES (TRADE_ID, TICKER, BUY_ORDER_ID, SELL_ORDER_ID, PRICE, QUANTITY) VALUES (?, ?, ?, ?, ?, ?);");
+        deleteOrderStatement.prepare(DB, "deleteOrder", "DELETE FROM ORDERS WHERE ORDER_ID = ?;");
+        updateOrderStatement.prepare(DB, "updateOrder",
+            "UPDATE ORDERS SET PRICE = ?1, QUANTITY = ?2, REMAINING = ?2, "
+            "FILLED_THROUGH = COALESCE(NULLIF(?4, 0), (SELECT COALESCE(MAX(TRADE_ID), 0) FROM TRADES)) "
+            "WHERE ORDER_ID = ?3;");
+        updateJournalSequenceStatement.prepare(DB, "updateJournalSeq",
+            "INSERT OR REPLACE INTO META (KEY, VALUE) VALUES ('journal_sequence', ?);");
+        // Subtract every trade newer than an order's FILLED_THROUGH, for all orders that traded
+        // at or after ?1. Trades carry their journal sequence as TRADE_ID, so running this again
+        // after a journal replay finds nothing new and changes nothing.
+        applyFillsStatement.prepare(DB, "applyFills",
+            "UPDATE ORDERS SET "
+            "REMAINING = MAX(ROUND(REMAINING"
+            " - COALESCE((SELECT SUM(QUANTITY) FROM TRADES WHERE BUY_ORDER_ID = ORDERS.ORDER_ID AND TRADE_ID > ORDERS.FILLED_THROUGH), 0)"
+            " - COALESCE((SELECT SUM(QUANTITY) FROM TRADES WHERE SELL_ORDER_ID = ORDERS.ORDER_ID AND TRADE_ID > ORDERS.FILLED_THROUGH), 0), 9), 0), "
+            "FILLED_THROUGH = MAX(FILLED_THROUGH,"
+            " COALESCE((SELECT MAX(TRADE_ID) FROM TRADES WHERE BUY_ORDER_ID = ORDERS.ORDER_ID), 0),"
+            " COALESCE((SELECT MAX(TRADE_ID) FROM TRADES WHERE SELL_ORDER_ID = ORDERS.ORDER_ID), 0)) "
+            "WHERE ORDER_ID IN (SELECT BUY_ORDER_ID FROM TRADES WHERE TRADE_ID >= ?1"
+            " UNION SELECT SELL_ORDER_ID FROM TRADES WHERE TRADE_ID >= ?1);");
+        selectLiveOrdersStatement.prepare(DB, "selectLiveOrders",
+            "SELECT ORDER_ID, TICKER, PRICE, REMAINING, SIDE FROM ORDERS WHERE REMAINING > 0 ORDER BY ORDER_ID;");
+
+        journalWatermark.reset(journalSequence());
+        return exit == SQLITE_OK;
+    }
+
+    // Highest journal sequence number already written to the DB (0 if none)
+    std::uint64_t journalSequence() override {
+        std::lock_guard<std::mutex> dbLock(dbMutex);
+        std::uint64_t sequence = 0;
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_prepare_v2(DB, "SELECT VALUE FROM META WHERE KEY = 'journal_sequence';", -1, &statement, nullptr) == SQLITE_OK
+            && sqlite3_step(statement) == SQLITE_ROW) {
+            sequence = static_cast<std::uint64_t>(sqlite3_column_int64(statement, 0));
+        }
+        sqlite3_finalize(statement);
+        return sequence;
+    }
+
+    // Print execution counts and average time of every cached statement
+    // The counters are copied under dbMutex and printed after it is released
+    void displayStatementStats() const {
+        std::vector<CachedStatement> counters;
+        {
+            std::lock_guard<std::mutex> dbLock(dbMutex);
+            counters = {insertOrderStatement, insertTradeStatement, deleteOrderStatement,
+                        updateOrderStatement, updateJournalSequenceStatement, applyFillsStatement,
+                        selectLiveOrdersStatement};
+        }
+        std::vector<const CachedStatement*> statements;
+        for (const CachedStatement& cached : counters) statements.push_back(&cached);
+        printStatementStats(statements);
+    }
+
+    // Open an explicit transaction for a batch of events (EventSink)
+    void beginBatch() override {
+        batchLock = std::unique_lock<std::mutex>(dbMutex);
+        watermarkAtBegin = journalWatermark;
+        batchFailed = sqlite3_exec(DB, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK;
+        if (batchFailed) {
+            std::cerr << "Error starting order history transaction: " << sqlite3_errmsg(DB) << std::endl;
+        }
+    }
+
+    // Commit the current batch of events (EventSink). The journal watermark is stored with
+    // the batch and only counts as committed once COMMIT succeeds. If any write or the
+    // COMMIT failed, the batch is rolled back and the watermark put back where it was, so
+    // the events can be written again.
+    bool commitBatch() override {
+        applyPendingFills();
+        bool stored = !batchFailed;
+        if (stored && journalWatermark.advanced()) {
+            StatementRun run(updateJournalSequenceStatement);
+            sqlite3_bind_int64(run.get(), 1, static_cast<sqlite3_int64>(journalWatermark.highWater()));
+            stored = run.get() && sqlite3_step(run.get()) == SQLITE_DONE;
+        }
+        if (stored) {
+            stored = sqlite3_exec(DB, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+        }
+        if (stored) {
+            journalWatermark.markCommitted();
+        } else {
+            std::cerr << "Error committing order history: " << sqlite3_errmsg(DB) << std::endl;
+            if (!sqlite3_get_autocommit(DB)) {
+                sqlite3_exec(DB, "ROLLBACK;", nullptr, nullptr, nullptr);
+            }
+            journalWatermark = watermarkAtBegin;
+        }
+        batchLock.unlock();
+        return stored;
+    }
+
+    // Write one event outside any batch, in autocommit mode (EventSink)
+    void writeInline(const PersistEvent& event) override {
+        std::lock_guard<std::mutex> dbLock(dbMutex);
+        writeEvent(event);
+        applyPendingFills();
+    }
+
+    // Write one event to order history; the caller holds dbMutex (EventSink)
+    void writeEvent(const PersistEvent& event) override {
+        journalWatermark.note(event.sequence);
+        CachedStatement* cached = nullptr;
+        switch (event.type) {
+            case PersistEventType::ORDER: cached = &insertOrderStatement; break;
+            case PersistEventType::FILL: cached = &insertTradeStatement; break;
+            case PersistEventType::CANCEL: cached = &deleteOrderStatement; break;
+            case PersistEventType::MODIFY: cached = &updateOrderStatement; break;
+        }
+
+        StatementRun run(*cached);
+        sqlite3_stmt *statement = run.get();
+        if (!statement) {
+            return;
+        }
+        switch (event.type) {
+            case PersistEventType::ORDER:
+                sqlite3_bind_int(statement, 1, event.orderId);
+                sqlite3_bind_text(statement, 2, event.ticker, -1, SQLITE_STATIC);
+                sqlite3_bind_double(statement, 3, event.price);
+                sqlite3_bind_double(statement, 4, event.quantity);
+                sqlite3_bind_int(statement, 5, static_cast<int>(event.side));
+                sqlite3_bind_int64(statement, 6, static_cast<sqlite3_int64>(event.sequence));
+                break;
+            case PersistEventType::FILL:
+                // Journaled trades are keyed by their sequence number so a replay rewrites the same row
+                if (event.sequence > 0) {
+                    sqlite3_bind_int64(statement, 1, static_cast<sqlite3_int64>(event.sequence));
+                }
+                sqlite3_bind_text(statement, 2, event.ticker, -1, SQLITE_STATIC);
+                sqlite3_bind_int(statement, 3, event.side == Side::BUY ? event.orderId : event.matchedOrderId);
+                sqlite3_bind_int(statement, 4, event.side == Side::BUY ? event.matchedOrderId : event.orderId);
+                sqlite3_bind_double(statement, 5, event.price);
+                sqlite3_bind_double(statement, 6, event.quantity);
+                break;
+            case PersistEventType::CANCEL:
+                sqlite3_bind_int(statement, 1, event.orderId);
+                break;
+            case PersistEventType::MODIFY:
+                sqlite3_bind_double(statement, 1, event.price);
+                sqlite3_bind_double(statement, 2, event.quantity);
+                sqlite3_bind_int(statement, 3, event.orderId);
+                sqlite3_bind_int64(statement, 4, static_cast<sqlite3_int64>(event.sequence));
+                break;
+        }
+
+        if (sqlite3_step(statement) != SQLITE_DONE) {
+            std::cerr << "Error writing order history: " << sqlite3_errmsg(DB) << std::endl;
+            batchFailed = true;
+            return;
+        }
+
+        // Remaining quantities are brought up to date once per batch rather than once per fill
+        if (event.type == PersistEventType::FILL) {
+            auto tradeId = static_cast<std::uint64_t>(sqlite3_last_insert_rowid(DB));
+            pendingFillsFrom = pendingFillsFrom ? std::min(pendingFillsFrom, tradeId) : tradeId;
+        }
+    }
+
+    // Rebuild the book from the orders in history that still have quantity open, scanning
+    // with loadThreads connections; falls back to one if the extra connections cannot be opened
+    void loadLiveOrders(OrderBook& book) override {
+        if (!loadOrdersParallel(dbPath, book, loadThreads)) {
+            loadLiveOrdersSerial(book);
+        }
+    }
+
+    // Rebuild the book from the orders in history that still have quantity open, on this
+    // connection and thread; see loadLiveOrders for the parallel loader
+    void loadLiveOrdersSerial(OrderBook& book) {
+        std::lock_guard<std::mutex> dbLock(dbMutex);
+        sqlite3_stmt* maxIdStatement = nullptr;
+        if (sqlite3_prepare_v2(DB, "SELECT COALESCE(MAX(ORDER_ID), 0) FROM ORDERS;", -1, &maxIdStatement, nullptr) == SQLITE_OK
+            && sqlite3_step(maxIdStatement) == SQLITE_ROW) {
+            book.lastOrderId = std::max(book.lastOrderId, sqlite3_column_int(maxIdStatement, 0));
+        }
+        sqlite3_finalize(maxIdStatement);
+
+        StatementRun run(selectLiveOrdersStatement);
+        sqlite3_stmt* statement = run.get();
+        if (!statement) {
+            return;
+        }
+
+        while (sqlite3_step(statement) == SQLITE_ROW) {
+            int orderId = sqlite3_column_int(statement, 0);
+            const unsigned char* raw = sqlite3_column_text(statement, 1);
+            std::string ticker = raw ? reinterpret_cast<const char*>(raw) : "";
+            double price = sqlite3_column_double(statement, 2);
+            double quantity = sqlite3_column_double(statement, 3);
+            int sideInt = sqlite3_column_int(statement, 4);
+            Side side = (sideInt == 0) ? Side::BUY : Side::SELL;
+
+            Order order(orderId, price, quantity, side, ticker);
+            book.restOrder(order);
+        }
+    }
+
+private:
+    std::unique_lock<std::mutex> batchLock;  // Held by the persistence stage between begin and commit
+
+    JournalWatermark journalWatermark;  // Stored in META as journal_sequence
+    JournalWatermark watermarkAtBegin;  // Restored if the batch fails to commit
+    bool batchFailed = false;           // BEGIN or a write of the current batch failed
+
+    std::uint64_t pendingFillsFrom = 0;  // Lowest TRADE_ID written since remaining quantities were updated
+
+    // Apply the trades written since the last call to ORDERS.REMAINING; the caller holds dbMutex
+    void applyPendingFills() {
+        if (pendingFillsFrom == 0) return;
+        StatementRun run(applyFillsStatement);
+        if (run.get()) {
+            sqlite3_bind_int64(run.get(), 1, static_cast<sqlite3_int64>(pendingFillsFrom));
+            if (sqlite3_step(run.get()) != SQLITE_DONE) {
+                std::cerr << "Error updating remaining quantities: " << sqlite3_errmsg(DB) << std::endl;
+            }
+        }
+        pendingFillsFrom = 0;
+    }
+
+    // Databases written before ORDERS tracked remaining quantity get the new columns,
+    // filled in from the trades already recorded
+    void migrateOrdersTable() {
+        std::string sql;
+        if (!ordersHasColumn("REMAINING")) {
+            sql += "ALTER TABLE ORDERS ADD COLUMN REMAINING REAL NOT NULL DEFAULT 0;"
+                   "ALTER TABLE ORDERS ADD COLUMN FILLED_THROUGH INT NOT NULL DEFAULT 0;"
+                   "UPDATE ORDERS SET "
+                   "REMAINING = MAX(QUANTITY - COALESCE((SELECT SUM(QUANTITY) FROM TRADES"
+                   " WHERE BUY_ORDER_ID = ORDERS.ORDER_ID OR SELL_ORDER_ID = ORDERS.ORDER_ID), 0), 0), "
+                   "FILLED_THROUGH = (SELECT COALESCE(MAX(TRADE_ID), 0) FROM TRADES);";
+        }
+        // Orders recorded before CREATED_AT existed keep 0 (unknown)
+        if (!ordersHasColumn("CREATED_AT")) {
+            sql += "ALTER TABLE ORDERS ADD COLUMN CREATED_AT INT NOT NULL DEFAULT 0;";
+        }
+        if (sql.empty()) return;
+
+        char* messageError = nullptr;
+        if (sqlite3_exec(DB, sql.c_str(), nullptr, nullptr, &messageError) != SQLITE_OK) {
+            std::cerr << "Error migrating ORDERS table: " << messageError << std::endl;
+            sqlite3_free(messageError);
+        }
+    }
+
+    bool ordersHasColumn(const char* name) const {
+        bool found = false;
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_prepare_v2(DB, "PRAGMA table_info(ORDERS);", -1, &statement, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(statement) == SQLITE_ROW) {
+                const unsigned char* column = sqlite3_column_text(statement, 1);
+                if (column && std::strcmp(reinterpret_cast<const char*>(column), name) == 0) {
+                    found = true;
+                }
+            }
+        }
+        sqlite3_finalize(statement);
+        return found;
+    }
+};
+
+#endif // SQLITESTORE_H
@@ -0,0 +1,84 @@
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+// A SQLite statement prepared once and reused for every execution.
+// Tracks how often it ran and how long it took, including binding and stepping.
+class CachedStatement {
+public:
+    std::string name;
+    sqlite3_stmt* statement = nullptr;
+    std::uint64_t executions = 0;
+    std::uint64_t totalNanos = 0;
+
+    bool prepare(sqlite3* db, const std::string& statementName, const char* sql) {
+        name = statementName;
+        if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK) {
+            std::cerr << "Failed to prepare " << name << " statement: " << sqlite3_errmsg(db) << std::endl;
+            statement = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void finalize() {
+        sqlite3_finalize(statement);
+        statement = nullptr;
+    }
+
+    [[nodiscard]] double averageMicros() const {
+        return executions ? static_cast<double>(totalNanos) / executions / 1000.0 : 0.0;
+    }
+};
+
+// One execution of a cached statement. Resets the statement and clears its bindings
+// when it goes out of scope, and records the elapsed time against the statement.
+class StatementRun {
+public:
+    explicit StatementRun(CachedStatement& cached)
+        : cached_(cached), start_(std::chrono::steady_clock::now()) {}
+
+    ~StatementRun() {
+        if (cached_.statement) {
+            sqlite3_reset(cached_.statement);
+            sqlite3_clear_bindings(cached_.statement);
+        }
+        ++cached_.executions;
+        cached_.totalNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count();
+    }
+
+    StatementRun(const StatementRun&) = delete;
+    StatementRun& operator=(const StatementRun&) = delete;
+
+    [[nodiscard]] sqlite3_stmt* get() const { return cached_.statement; }
+
+private:
+    CachedStatement& cached_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Print execution counts and average latency for a set of cached statements
+inline void printStatementStats(const std::vector<const CachedStatement*>& statements) {
+    std::cout << std::left
+              << std::setw(20) << "STATEMENT"
+              << std::setw(14) << "EXECUTIONS"
+              << std::setw(14) << "AVG (us)" << std::endl;
+    std::cout << std::string(48, '-') << std::endl;
+    for (const CachedStatement* cached : statements) {
+        std::cout << std::left
+                  << std::setw(20) << cached->name
+                  << std::setw(14) << cached->executions
+                  << std::setw(14) << std::fixed << std::setprecision(2) << cached->averageMicros()
+                  << std::defaultfloat << std::endl;
+    }
+}
+
+#endif // STATEMENTCACHE_H
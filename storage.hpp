@@ -0,0 +1,60 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <cstdint>
+#include "orderbook.hpp"
+#include "journal.hpp"
+
+// Where order history is kept. A backend receives the book's events (EventSink) and can
+// rebuild the live book at startup (recovery source). It is chosen when the book is set up.
+class StorageBackend : public EventSink {
+public:
+    [[nodiscard]] virtual const char* name() const = 0;
+
+    // Highest journal sequence number already stored; the journal after it is replayed into the backend
+    virtual std::uint64_t journalSequence() = 0;
+
+    // Rest every order that is still live in history into an empty book
+    virtual void loadLiveOrders(OrderBook& book) = 0;
+};
+
+// Records nothing and recovers nothing, so the matcher runs at memory speed.
+// For simulations, backtests and benchmarks.
+class NullStore : public StorageBackend {
+public:
+    [[nodiscard]] const char* name() const override { return "null"; }
+    std::uint64_t journalSequence() override { return 0; }
+    void loadLiveOrders(OrderBook&) override {}
+    void beginBatch() override {}
+    void writeEvent(const PersistEvent&) override {}
+    bool commitBatch() override { return true; }
+    void writeInline(const PersistEvent&) override {}
+};
+
+// The journal on its own as order history. Events are durable once appended, so there is
+// nothing more to write; the live book is recovered by replaying the whole journal.
+class JournalStore : public StorageBackend {
+public:
+    explicit JournalStore(const EventJournal& journal) : journal_(journal) {}
+
+    [[nodiscard]] const char* name() const override { return "journal"; }
+
+    std::uint64_t journalSequence() override {
+        return journal_.nextSequence() - 1;
+    }
+
+    void loadLiveOrders(OrderBook& book) override {
+        journal_.replay(journal_.firstSequence(), [&book](const PersistEvent& event) {
+            book.applyEvent(event);
+        });
+    }
+
+    void beginBatch() override {}
+    void writeEvent(const PersistEvent&) override {}
+    bool commitBatch() override { return true; }
+
+private:
+    const EventJournal& journal_;
+};
+
+#endif // STORAGE_H
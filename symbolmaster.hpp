@@ -0,0 +1,233 @@
+#ifndef SYMBOLMASTER_H
+#define SYMBOLMASTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "numparse.hpp"
+#include "tickercache.hpp"
+
+// Reference data for one tradable symbol
+struct SymbolInfo {
+    std::string ticker;
+    double tickSize = 0.01;  // Prices must be a multiple of this
+    double lotSize = 1;      // Quantities must be a multiple of this
+    Decimal tick{1, 2};      // tickSize and lotSize exactly, as written in the file
+    Decimal lot{1, 0};
+    bool active = true;
+};
+
+// True if value is a whole multiple of increment, allowing for binary rounding
+inline bool onIncrement(double value, double increment) {
+    if (increment <= 0) return true;
+    double steps = value / increment;
+    return std::fabs(steps - std::round(steps)) <= 1e-6 * std::max(1.0, std::fabs(steps));
+}
+
+// Immutable symbol table, sorted by ticker and searched by binary search.
+// Built once from a symbol master file and never changed afterwards, so any number of
+// threads can read it without locking.
+class SymbolIndex {
+public:
+    // Parse a symbol master file: a TICKER,TICK_SIZE,LOT_SIZE,ACTIVE header followed by one
+    // line per symbol. Blank lines and lines starting with '#' are skipped. On failure error
+    // says which line is wrong.
+    bool load(const std::string& path, std::string& error) {
+        std::ifstream in(path);
+        if (!in) {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::vector<SymbolInfo> symbols;
+        std::string line;
+        std::size_t lineNumber = 0;
+        bool headerSeen = false;
+        while (std::getline(in, line)) {
+            ++lineNumber;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            if (!headerSeen) {
+                headerSeen = true;
+                if (line.rfind("TICKER,", 0) == 0) continue;
+            }
+            SymbolInfo symbol;
+            if (!parseLine(line, symbol)) {
+                error = path + ":" + std::to_string(lineNumber) + ": expected TICKER,TICK_SIZE,LOT_SIZE,ACTIVE";
+                return false;
+            }
+            symbols.push_back(std::move(symbol));
+        }
+
+        std::sort(symbols.begin(), symbols.end(),
+                  [](const SymbolInfo& a, const SymbolInfo& b) { return a.ticker < b.ticker; });
+        auto duplicate = std::adjacent_find(symbols.begin(), symbols.end(),
+                  [](const SymbolInfo& a, const SymbolInfo& b) { return a.ticker == b.ticker; });
+        if (duplicate != symbols.end()) {
+            error = path + ": " + duplicate->ticker + " is listed more than once";
+            return false;
+        }
+        symbols_ = std::move(symbols);
+        return true;
+    }
+
+    // The symbol's reference data, or null if it is not listed
+    [[nodiscard]] const SymbolInfo* find(std::string_view ticker) const {
+        auto it = std::lower_bound(symbols_.begin(), symbols_.end(), ticker,
+                                   [](const SymbolInfo& symbol, std::string_view key) { return symbol.ticker < key; });
+        return it != symbols_.end() && it->ticker == ticker ? &*it : nullptr;
+    }
+
+    [[nodiscard]] std::size_t size() const { return symbols_.size(); }
+    [[nodiscard]] std::size_t activeCount() const {
+        return static_cast<std::size_t>(std::count_if(symbols_.begin(), symbols_.end(),
+                                                      [](const SymbolInfo& symbol) { return symbol.active; }));
+    }
+
+private:
+    static bool parseLine(const std::string& line, SymbolInfo& symbol) {
+        std::stringstream fields(line);
+        std::string tick, lot, active;
+        if (!std::getline(fields, symbol.ticker, ',') || !std::getline(fields, tick, ',')
+            || !std::getline(fields, lot, ',') || !std::getline(fields, active, ',')) {
+            return false;
+        }
+        if (!parseDecimal(tick, symbol.tick) || !parseDecimal(lot, symbol.lot)) {
+            return false;
+        }
+        if (symbol.ticker.empty() || symbol.tick.mantissa <= 0 || symbol.lot.mantissa <= 0) {
+            return false;
+        }
+        symbol.tickSize = toDouble(symbol.tick);
+        symbol.lotSize = toDouble(symbol.lot);
+        if (active == "1" || active == "true") {
+            symbol.active = true;
+        } else if (active == "0" || active == "false") {
+            symbol.active = false;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<SymbolInfo> symbols_;
+};
+
+// Write a symbol master file. It is written beside the target and renamed over it,
+// so a reload running at the same time sees either the old file or the new one.
+// Tick and lot sizes are written from their exact decimals, so the file loads back unchanged.
+inline bool writeSymbolMaster(const std::string& path, std::vector<SymbolInfo> symbols) {
+    std::sort(symbols.begin(), symbols.end(),
+              [](const SymbolInfo& a, const SymbolInfo& b) { return a.ticker < b.ticker; });
+    symbols.erase(std::unique(symbols.begin(), symbols.end(),
+                              [](const SymbolInfo& a, const SymbolInfo& b) { return a.ticker == b.ticker; }),
+                  symbols.end());
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out) {
+            std::cerr << "Cannot write symbol master " << temporary << std::endl;
+            return false;
+        }
+        out << "TICKER,TICK_SIZE,LOT_SIZE,ACTIVE\n";
+        for (const SymbolInfo& symbol : symbols) {
+            out << symbol.ticker << ',' << formatDecimal(symbol.tick) << ',' << formatDecimal(symbol.lot) << ','
+                << (symbol.active ? 1 : 0) << '\n';
+        }
+        if (!out.flush()) {
+            std::cerr << "Cannot write symbol master " << temporary << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot replace symbol master " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Local reference data for order validation, so accepting an order needs no network.
+// The index is published through an atomic shared_ptr: readers take the current index
+// without locking, and reload() builds a new one off to the side and swaps it in.
+// Readers that still hold the old index keep using it until they let go.
+class SymbolMaster {
+public:
+    // Load the symbol master at path; it is also the file reload() reads
+    bool load(const std::string& path) {
+        path_ = path;
+        return reload();
+    }
+
+    // Re-read the file and swap the new index in. On failure the current index stays.
+    bool reload() {
+        auto index = std::make_shared<SymbolIndex>();
+        std::string error;
+        if (!index->load(path_, error)) {
+            std::cerr << "Error loading symbol master: " << error << std::endl;
+            return false;
+        }
+        index_.store(std::move(index));
+        return true;
+    }
+
+    [[nodiscard]] std::shared_ptr<const SymbolIndex> index() const {
+        return index_.load();
+    }
+
+    [[nodiscard]] bool loaded() const {
+        return index_.load() != nullptr;
+    }
+
+    [[nodiscard]] const std::string& path() const { return path_; }
+
+    // ACTIVE or INACTIVE from the current index; symbols not listed are INACTIVE
+    [[nodiscard]] TickerStatus status(const std::string& ticker) const {
+        auto index = index_.load();
+        const SymbolInfo* symbol = index ? index->find(ticker) : nullptr;
+        return symbol && symbol->active ? TickerStatus::ACTIVE : TickerStatus::INACTIVE;
+    }
+
+    // Why an order at this price and quantity breaks the symbol's tick or lot size, or empty if it doesn't
+    [[nodiscard]] std::string checkOrder(const std::string& ticker, double price, double quantity) const {
+        auto index = index_.load();
+        const SymbolInfo* symbol = index ? index->find(ticker) : nullptr;
+        if (!symbol) return "";
+        std::ostringstream reason;
+        if (!onIncrement(price, symbol->tickSize)) {
+            reason << "Price " << price << " is not a multiple of the " << ticker << " tick size " << symbol->tickSize << ".";
+        } else if (!onIncrement(quantity, symbol->lotSize)) {
+            reason << "Quantity " << quantity << " is not a multiple of the " << ticker << " lot size " << symbol->lotSize << ".";
+        }
+        return reason.str();
+    }
+
+    // The same check for a price and quantity as entered, done exactly: both must come to a
+    // whole number of the symbol's ticks and lots, with no allowance for rounding
+    [[nodiscard]] std::string checkOrder(const std::string& ticker, const Decimal& price, const Decimal& quantity) const {
+        auto index = index_.load();
+        const SymbolInfo* symbol = index ? index->find(ticker) : nullptr;
+        if (!symbol) return "";
+        std::int64_t ticks = 0, lots = 0;
+        std::ostringstream reason;
+        if (!toIncrements(price, symbol->tick, ticks)) {
+            reason << "Price " << toDouble(price) << " is not a multiple of the " << ticker << " tick size " << symbol->tickSize << ".";
+        } else if (!toIncrements(quantity, symbol->lot, lots)) {
+            reason << "Quantity " << toDouble(quantity) << " is not a multiple of the " << ticker << " lot size " << symbol->lotSize << ".";
+        }
+        return reason.str();
+    }
+
+private:
+    std::string path_;
+    std::atomic<std::shared_ptr<const SymbolIndex>> index_;
+};
+
+#endif // SYMBOLMASTER_H
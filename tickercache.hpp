@@ -0,0 +1,108 @@
+#ifndef TICKERCACHE_H
+#define TICKERCACHE_H
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Outcome of asking reference data about a symbol
+enum class TickerStatus {
+    ACTIVE,       // Known and trading
+    INACTIVE,     // Unknown or delisted; cached as a negative answer
+    UNAVAILABLE   // The lookup itself failed; never cached, so the next call asks again
+};
+
+// How long answers are trusted
+struct TickerCachePolicy {
+    std::chrono::seconds positiveTtl{3600};
+    std::chrono::seconds negativeTtl{300};
+};
+
+// In-process cache in front of a slow ticker lookup (an HTTPS round trip).
+// A cached answer costs one hash lookup under a shared lock. On a miss, concurrent callers
+// asking about the same symbol share a single in-flight lookup instead of each making one.
+// Thread-safe.
+class TickerValidationCache {
+public:
+    using Lookup = std::function<TickerStatus(const std::string&)>;
+
+    explicit TickerValidationCache(Lookup lookup, TickerCachePolicy policy = {})
+        : lookup_(std::move(lookup)), policy_(policy) {}
+
+    // True if the ticker is active, asking the lookup only when no fresh answer is cached
+    bool validate(const std::string& ticker) {
+        return status(ticker) == TickerStatus::ACTIVE;
+    }
+
+    TickerStatus status(const std::string& ticker) {
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = entries_.find(ticker);
+            if (it != entries_.end() && now < it->second.expires) {
+                return it->second.status;
+            }
+        }
+
+        std::promise<TickerStatus> promise;
+        std::shared_future<TickerStatus> pending;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            auto it = entries_.find(ticker);
+            if (it != entries_.end() && now < it->second.expires) {
+                return it->second.status;
+            }
+            auto inFlight = inFlight_.find(ticker);
+            if (inFlight != inFlight_.end()) {
+                pending = inFlight->second;
+            } else {
+                inFlight_.emplace(ticker, promise.get_future().share());
+            }
+        }
+        if (pending.valid()) {
+            return pending.get();
+        }
+
+        // This caller owns the lookup; the lock is not held while it runs
+        TickerStatus result = TickerStatus::UNAVAILABLE;
+        try {
+            result = lookup_(ticker);
+        } catch (const std::exception&) {
+            // Treated as unavailable
+        }
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            if (result != TickerStatus::UNAVAILABLE) {
+                auto ttl = result == TickerStatus::ACTIVE ? policy_.positiveTtl : policy_.negativeTtl;
+                entries_[ticker] = {result, std::chrono::steady_clock::now() + ttl};
+            }
+            inFlight_.erase(ticker);
+        }
+        promise.set_value(result);
+        return result;
+    }
+
+    // Forget every cached answer
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    struct Entry {
+        TickerStatus status;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    Lookup lookup_;
+    TickerCachePolicy policy_;
+    std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, std::shared_future<TickerStatus>> inFlight_;
+};
+
+#endif // TICKERCACHE_H